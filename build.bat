@@ -11,7 +11,7 @@ set LinkerOptions=-LIBPATH:..\win32_deps\lib -subsystem:console  User32.lib ole3
 if not exist build mkdir build
 pushd build
 
-cl %CompilerOptions% %WarningOptions% ..\src\netcheckers.c ..\src\network.c -link %LinkerOptions%
+cl %CompilerOptions% %WarningOptions% ..\src\netcheckers.c ..\src\network.c ..\src\bitboard.c ..\src\game.c ..\src\zobrist.c ..\src\eval.c ..\src\search.c ..\src\nn.c ..\src\tt.c ..\src\tablebase.c ..\src\book.c ..\src\file_map.c ..\src\thread.c ..\src\timer.c ..\src\startup_cmdline.c -link %LinkerOptions%
 
 copy ..\win32_deps\dlls\*.dll .
 
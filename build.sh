@@ -1,3 +1,3 @@
 #!/usr/bin/env bash
 
-clang src/netcheckers.c src/network.c -Wall -Wno-missing-braces -lSDL2 -lSDL2_image -o netcheckers
+clang src/netcheckers.c src/network.c src/bitboard.c src/game.c src/zobrist.c src/eval.c src/search.c src/nn.c src/tt.c src/tablebase.c src/book.c src/file_map.c src/thread.c src/timer.c src/startup_cmdline.c -Wall -Wno-missing-braces -lSDL2 -lSDL2_image -o netcheckers
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+# Command line tools built without SDL
+
+RULES="src/game.c src/bitboard.c src/zobrist.c src/eval.c"
+SEARCH="src/search.c src/nn.c src/tt.c src/tablebase.c src/file_map.c src/thread.c src/timer.c src/mcts.c"
+FLAGS="-Wall -Wno-missing-braces -O2 -pthread -lm"
+
+clang src/perft.c src/timer.c $RULES $FLAGS -o perft
+clang src/perft.c src/timer.c $RULES $FLAGS -DGRID_RULES -o perft_grid
+clang src/bench.c $SEARCH $RULES $FLAGS -o bench
+clang src/tbgen.c src/tablebase.c src/file_map.c src/thread.c src/timer.c $RULES $FLAGS -o tbgen
+clang src/bookgen.c src/book.c src/file_map.c $RULES $FLAGS -o bookgen
+clang src/hopbench.c src/bitboard_batch.c src/timer.c $RULES $FLAGS -o hopbench
+clang src/hopbench.c src/bitboard_batch.c src/timer.c $RULES $FLAGS -DGRID_RULES -o hopbench_grid
+clang src/engine.c $SEARCH $RULES $FLAGS -o netcheckers-engine
+clang src/selfplay.c $SEARCH $RULES $FLAGS -o selfplay
+clang src/mctsbench.c $SEARCH $RULES $FLAGS -o mctsbench
+clang src/perft.c src/timer.c $RULES $FLAGS -DRULES_BRAZILIAN -o perft_brazilian
+clang src/perft.c src/timer.c $RULES $FLAGS -DRULES_INTERNATIONAL -o perft_international
+clang src/engine.c $SEARCH $RULES $FLAGS -DRULES_BRAZILIAN -o netcheckers-engine-brazilian
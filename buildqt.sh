@@ -8,7 +8,7 @@ qmake ../qt_ui/qt_gui.pro
 make
 cd -
 
-clang src/netcheckers.c src/network.c "$QTBUILDDIR"/*.o \
+clang src/netcheckers.c src/network.c src/bitboard.c src/game.c src/zobrist.c src/eval.c src/search.c src/nn.c src/tt.c src/tablebase.c src/book.c src/file_map.c src/thread.c src/timer.c "$QTBUILDDIR"/*.o \
 	  -Wall -Wno-missing-braces \
 	  -L"$QTBUILDDIR" -lstdc++ -lQt5Core -lQt5Gui -lQt5Widgets -lqt \
 	  -lSDL2 -lSDL2_image \
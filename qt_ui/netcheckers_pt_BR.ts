@@ -37,72 +37,77 @@
         <translation>Cliente</translation>
     </message>
     <message>
-        <location filename="startupwindow.ui" line="68"/>
+        <location filename="startupwindow.ui" line="65"/>
+        <source>Computer</source>
+        <translation>Computador</translation>
+    </message>
+    <message>
+        <location filename="startupwindow.ui" line="73"/>
         <source>Host:</source>
         <translation>Host:</translation>
     </message>
     <message>
-        <location filename="startupwindow.ui" line="78"/>
+        <location filename="startupwindow.ui" line="83"/>
         <source>Port:</source>
         <translation>Porta:</translation>
     </message>
     <message>
-        <location filename="startupwindow.ui" line="115"/>
+        <location filename="startupwindow.ui" line="120"/>
         <source>Cancel</source>
         <translation>Cancelar</translation>
     </message>
     <message>
-        <location filename="startupwindow.ui" line="118"/>
+        <location filename="startupwindow.ui" line="123"/>
         <source>Esc</source>
         <translation type="unfinished"></translation>
     </message>
     <message>
-        <location filename="startupwindow.ui" line="125"/>
+        <location filename="startupwindow.ui" line="130"/>
         <source>Start</source>
         <translation>Iniciar</translation>
     </message>
     <message>
-        <location filename="startupwindow.ui" line="128"/>
+        <location filename="startupwindow.ui" line="133"/>
         <source>Return</source>
         <translation type="unfinished"></translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="57"/>
+        <location filename="../src/startup_qt.cpp" line="69"/>
         <source>Waiting for connections on port %1...</source>
         <translation>Esperando por conexões na porta %1...</translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="59"/>
+        <location filename="../src/startup_qt.cpp" line="71"/>
         <source>Connecting on %1 at port %2...</source>
         <translation>Conectando em %1 na porta %2...</translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="81"/>
+        <location filename="../src/startup_qt.cpp" line="93"/>
         <source>Connection refused</source>
         <translation>Conexão recusada</translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="84"/>
+        <location filename="../src/startup_qt.cpp" line="96"/>
         <source>Host %1 could not be found</source>
         <translation>Host %1 não foi encontrado</translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="87"/>
+        <location filename="../src/startup_qt.cpp" line="99"/>
         <source>The port %1 is alredy in use</source>
         <translation>A porta %1 já esta em uso</translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="90"/>
+        <location filename="../src/startup_qt.cpp" line="102"/>
         <source>No permission to use the port %1</source>
         <translation>Permissão negada para usar a porta %1</translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="94"/>
+        <location filename="../src/startup_qt.cpp" line="106"/>
         <source>Unknown error</source>
         <translation>Erro desconhecido</translation>
     </message>
     <message>
-        <location filename="../src/startup_qt.cpp" line="99"/>
+        <location filename="../src/startup_qt.cpp" line="111"/>
         <source>Failed to connect</source>
         <translation>Erro ao conectar</translation>
     </message>
@@ -0,0 +1,168 @@
+/*
+ * Searches a set of positions to a fixed depth with 1 up to N threads and
+ * reports nodes/sec and the speedup in time to depth over a single thread.
+ * Output is one tab separated line per thread count.
+ *
+ * With -ordering the positions are searched by a single thread, first with
+ * every move ordering heuristic, then without each of them and without any.
+ * Output is one line per heuristic left out and iteration, with the nodes
+ * and cutoffs of that iteration and the heuristic that ordered each cutoff
+ * move.
+ *
+ * With -nn the quiet positions are evaluated by the network of the weights
+ * file (see nn.h) instead of the handcrafted evaluation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "search.h"
+#include "thread.h"
+
+#define TT_MEGABYTES 64
+
+static const char *default_positions[] = {
+	"B:W1,2,3,4,5,6,7,8,9,10,11,12:B21,22,23,24,25,26,27,28,29,30,31,32",
+	"B:W1,2,3,4,6,7,8,9,10,12,20:B18,23,24,26,27,28,29,30,31,32",
+	"B:W3,4,5,6,7,8,9,10,12,15:B16,18,19,23,24,28,29,30,31,32",
+	"B:W4,5,6,7,8,9,10,12,15:B16,18,19,22,23,24,28,31,32",
+	"B:W4,7,8,9,10,11,12,15,17:B16,18,19,20,22,23,24,27,28",
+	"B:W8,9,11,17,18:B6,19,23,24,27,28",
+};
+
+static const struct {
+	const char *name;
+	unsigned disabled;
+} orderings[] = {
+	{ "all", 0 },
+	{ "no_hash_move", 1u << SEARCH_HASH_MOVE },
+	{ "no_captures", 1u << SEARCH_CAPTURES },
+	{ "no_killers", 1u << SEARCH_KILLERS },
+	{ "no_history", 1u << SEARCH_HISTORY },
+	{ "none", (1u << SEARCH_HEURISTICS) - 1 },
+};
+
+static void bench_ordering(game_state_t *games, int count, int depth, tt_t *tt, const nn_t *nn) {
+	if (depth > SEARCH_MAX_DEPTH)
+		depth = SEARCH_MAX_DEPTH;
+	printf("ordering\tdepth\tnodes\tseconds\tcutoffs\tfirst_cutoff_rate\thash_move\tcaptures\tkillers\thistory\n");
+	for (int o = 0; o < ARRAY_SIZE(orderings); o++) {
+		search_limits_t limits = { depth, 0, 1, orderings[o].disabled };
+		limits.nn = nn;
+		search_stats_t totals[SEARCH_MAX_DEPTH + 1];
+		memset(totals, 0, sizeof(totals));
+		for (int i = 0; i < count; i++) {
+			tt_clear(tt);
+			search_result_t result = search(&games[i].bitboard, games[i].current_turn, &limits, tt, 0);
+			for (int d = 1; d <= result.depth && d <= depth; d++) {
+				const search_stats_t *it = result.iterations + d;
+				totals[d].nodes += it->nodes;
+				totals[d].seconds += it->seconds;
+				totals[d].cutoffs += it->cutoffs;
+				totals[d].first_cutoffs += it->first_cutoffs;
+				for (int h = 0; h < SEARCH_HEURISTICS; h++)
+					totals[d].heuristic_cutoffs[h] += it->heuristic_cutoffs[h];
+			}
+		}
+		for (int d = 1; d <= depth; d++) {
+			const search_stats_t *t = totals + d;
+			printf("%s\t%d\t%llu\t%.6f\t%llu\t%.4f", orderings[o].name, d, (unsigned long long)t->nodes, t->seconds,
+				(unsigned long long)t->cutoffs, t->cutoffs ? (double)t->first_cutoffs / t->cutoffs : 0);
+			for (int h = 0; h < SEARCH_HEURISTICS; h++)
+				printf("\t%llu", (unsigned long long)t->heuristic_cutoffs[h]);
+			printf("\n");
+		}
+		fflush(stdout);
+	}
+}
+
+int main(int argc, char **argv) {
+	const char *program = argv[0];
+	const char *nn_path = 0;
+	if (argc > 2 && strcmp(argv[1], "-nn") == 0) {
+		nn_path = argv[2];
+		argc -= 2;
+		argv += 2;
+	}
+	bool ordering = argc > 1 && strcmp(argv[1], "-ordering") == 0;
+	if (argc < 3 || atoi(argv[ordering ? 2 : 1]) < 1 || (!ordering && atoi(argv[2]) < 1)) {
+		fprintf(stderr,
+			"Usage:\n"
+			"    %s [-nn FILE] DEPTH MAX_THREADS [FEN...]\n"
+			"    %s [-nn FILE] -ordering DEPTH [FEN...]\n"
+			"\n"
+			"Thread counts are the powers of two up to MAX_THREADS, and MAX_THREADS.\n"
+			"Without FENs a fixed set of opening and middle game positions is used.\n",
+			program, program
+		);
+		return 1;
+	}
+
+	int depth = atoi(argv[ordering ? 2 : 1]);
+	int max_threads = ordering ? 1 : atoi(argv[2]);
+	const char **fens = default_positions;
+	int fen_count = ARRAY_SIZE(default_positions);
+	if (argc > 3) { // both forms take two arguments before the FENs
+		fens = (const char **)argv + 3;
+		fen_count = argc - 3;
+	}
+
+	game_state_t *games = malloc(fen_count * sizeof(game_state_t));
+	tt_t *tt = tt_create(TT_MEGABYTES);
+	if (!games || !tt)
+		return 1;
+	nn_t *nn = 0;
+	if (nn_path) {
+		nn = nn_open(nn_path);
+		if (!nn) {
+			fprintf(stderr, "ERROR could not load the network: %s\n", nn_path);
+			return 1;
+		}
+		fprintf(stderr, "network %s, %s kernel\n", nn_path, nn_kernel_name(nn_kernel(nn)));
+	}
+	for (int i = 0; i < fen_count; i++) {
+		if (!game_load_fen(games + i, fens[i])) {
+			fprintf(stderr, "ERROR invalid FEN: %s\n", fens[i]);
+			return 1;
+		}
+	}
+
+	if (ordering) {
+		bench_ordering(games, fen_count, depth, tt, nn);
+		if (nn)
+			nn_close(nn);
+		tt_destroy(tt);
+		free(games);
+		return 0;
+	}
+
+	printf("threads\tdepth\tnodes\tseconds\tnodes_per_sec\tnodes_per_sec_per_thread\tspeedup\n");
+	double single_seconds = 0;
+	for (int threads = 1; threads <= max_threads; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2) {
+		search_limits_t limits = { depth, 0, threads };
+		limits.nn = nn;
+		uint64_t nodes = 0;
+		double seconds = 0;
+		for (int i = 0; i < fen_count; i++) {
+			tt_clear(tt);
+			search_result_t result = search(&games[i].bitboard, games[i].current_turn, &limits, tt, 0);
+			nodes += result.nodes;
+			seconds += result.seconds;
+		}
+		if (threads == 1)
+			single_seconds = seconds;
+
+		double nps = (seconds > 0) ? nodes / seconds : 0;
+		double speedup = (seconds > 0) ? single_seconds / seconds : 0;
+		printf("%d\t%d\t%llu\t%.6f\t%.0f\t%.0f\t%.2f\n",
+			threads, depth, (unsigned long long)nodes, seconds, nps, nps / threads, speedup);
+		fflush(stdout);
+	}
+
+	if (nn)
+		nn_close(nn);
+	tt_destroy(tt);
+	free(games);
+	return 0;
+}
@@ -0,0 +1,510 @@
+#include <assert.h>
+
+#include "bitboard.h"
+
+#define SQUARE_STEPS(square) { \
+	BB_SHIFT_DOWN_RIGHT(BB_BIT(square)), BB_SHIFT_DOWN_LEFT(BB_BIT(square)), \
+	BB_SHIFT_UP_RIGHT(BB_BIT(square)), BB_SHIFT_UP_LEFT(BB_BIT(square)) }
+#define SQUARE_JUMPS(square) { \
+	BB_SHIFT_DOWN_RIGHT(BB_SHIFT_DOWN_RIGHT(BB_BIT(square))), BB_SHIFT_DOWN_LEFT(BB_SHIFT_DOWN_LEFT(BB_BIT(square))), \
+	BB_SHIFT_UP_RIGHT(BB_SHIFT_UP_RIGHT(BB_BIT(square))), BB_SHIFT_UP_LEFT(BB_SHIFT_UP_LEFT(BB_BIT(square))) }
+#if RULES_BOARD_SIZE == 10
+#define ROW_OF(entry, row) \
+	entry(5 * (row)), entry(5 * (row) + 1), entry(5 * (row) + 2), entry(5 * (row) + 3), entry(5 * (row) + 4)
+#define BOARD_OF(entry) \
+	ROW_OF(entry, 0), ROW_OF(entry, 1), ROW_OF(entry, 2), ROW_OF(entry, 3), ROW_OF(entry, 4), \
+	ROW_OF(entry, 5), ROW_OF(entry, 6), ROW_OF(entry, 7), ROW_OF(entry, 8), ROW_OF(entry, 9)
+#else
+#define ROW_OF(entry, row) entry(4 * (row)), entry(4 * (row) + 1), entry(4 * (row) + 2), entry(4 * (row) + 3)
+#define BOARD_OF(entry) \
+	ROW_OF(entry, 0), ROW_OF(entry, 1), ROW_OF(entry, 2), ROW_OF(entry, 3), \
+	ROW_OF(entry, 4), ROW_OF(entry, 5), ROW_OF(entry, 6), ROW_OF(entry, 7)
+#endif
+
+const bb_bits_t bb_steps[BB_SQUARES][4] = { BOARD_OF(SQUARE_STEPS) };
+const bb_bits_t bb_jumps[BB_SQUARES][4] = { BOARD_OF(SQUARE_JUMPS) };
+
+// Returns -1 for light squares and positions outside the board
+extern int bb_square(cell_pos_t pos) {
+	int result = -1;
+	if (pos.row >= 0 && pos.row < RULES_BOARD_SIZE && pos.col >= 0 && pos.col < RULES_BOARD_SIZE && (pos.row + pos.col) % 2 == 0)
+		result = pos.row * BB_HALF + pos.col / 2;
+	return result;
+}
+
+extern cell_pos_t bb_cell(int square) {
+	cell_pos_t result;
+	result.row = square / BB_HALF;
+	result.col = (square % BB_HALF) * 2 + (result.row % 2);
+	return result;
+}
+
+#if RULES_FLYING_KINGS
+// The first piece a king on the square meets along the direction, 0 if it
+// reaches the edge first
+static inline bb_bits_t first_blocker(int square, bb_dir_t dir, bb_bits_t occupied) {
+	bb_bits_t bit = bb_steps[square][dir];
+	while (bit && !(bit & occupied))
+		bit = bb_steps[bb_first(bit)][dir];
+	return bit;
+}
+
+static bool king_can_capture(int square, bb_bits_t occupied, bb_bits_t opponent) {
+	for (int dir = 0; dir < 4; dir++) {
+		bb_bits_t blocker = first_blocker(square, dir, occupied);
+		if ((blocker & opponent) && (bb_steps[bb_first(blocker)][dir] & ~occupied))
+			return true;
+	}
+	return false;
+}
+#endif
+
+#if RULES_MAXIMUM_CAPTURE
+// Flying kings on 10x10 go through many more states of a chain
+#if RULES_BOARD_SIZE == 10
+	#define CHAIN_MEMO_SIZE 16384 // a power of two
+#else
+	#define CHAIN_MEMO_SIZE 1024
+#endif
+#define CHAIN_MEMO_PROBES 8
+
+#ifdef _MSC_VER
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#define THREAD_LOCAL __thread
+#endif
+
+// Longest chains already known, by the square the piece left, the square it
+// is on and the pieces it took so far. As the taken pieces stay on the board
+// and nothing is crowned until the chain ends, those make the whole state of
+// a chain: a king reaching the same square by another order of the same
+// captures isn't searched again.
+typedef struct {
+	bb_bits_t captures;
+	uint32_t generation; // of the search that stored it, older entries are free
+	int8_t origin;
+	int8_t square;
+	int8_t longest; // captures still possible from there
+} chain_entry_t;
+
+typedef struct {
+	chain_entry_t entries[CHAIN_MEMO_SIZE];
+	uint32_t generation;
+} chain_memo_t;
+
+// One per thread, kept between the calls so it isn't cleared for each one
+static THREAD_LOCAL chain_memo_t chain_memo;
+
+// Empties the memo of the thread for the chains of a new position
+static chain_memo_t *chain_memo_start(void) {
+	chain_memo_t *memo = &chain_memo;
+	if (++memo->generation == 0) { // entries from before the wrap would look current
+		for (int i = 0; i < CHAIN_MEMO_SIZE; i++)
+			memo->entries[i].generation = 0;
+		memo->generation = 1;
+	}
+	return memo;
+}
+
+// The entry of the state, found tells if it holds it already. Otherwise it is
+// the entry to store it in: a free one, or else the one that took the most
+// pieces, whose chain is the quickest to search again.
+static chain_entry_t *chain_memo_probe(chain_memo_t *memo, int origin, int square, bb_bits_t captures, bool *found) {
+	uint64_t key = (uint64_t)captures * 0x9E3779B97F4A7C15ull ^ (uint64_t)(origin * BB_SQUARES + square) * 0xC2B2AE3D27D4EB4Full;
+	uint32_t index = (uint32_t)(key >> 32);
+	chain_entry_t *result = 0;
+	*found = false;
+	for (uint32_t i = 0; i < CHAIN_MEMO_PROBES; i++) {
+		chain_entry_t *entry = memo->entries + ((index + i) & (CHAIN_MEMO_SIZE - 1));
+		if (entry->generation != memo->generation) {
+			if (!result || result->generation == memo->generation)
+				result = entry;
+		} else if (entry->origin == origin && entry->square == square && entry->captures == captures) {
+			*found = true;
+			return entry;
+		} else if (!result || (result->generation == memo->generation && bb_count(entry->captures) > bb_count(result->captures))) {
+			result = entry;
+		}
+	}
+	return result;
+}
+
+// The captures a piece on the square can make next, as the bits of the piece
+// taken and of the square landed on
+static int capture_hops(int square, bb_bits_t occupied, bb_bits_t opponent, bool king, piece_color_t color,
+		bb_bits_t steps[BB_SQUARE_HOPS], bb_bits_t lands[BB_SQUARE_HOPS]) {
+	int count = 0;
+	for (int dir = 0; dir < 4; dir++) {
+#if RULES_FLYING_KINGS
+		if (king) {
+			bb_bits_t step = first_blocker(square, dir, occupied) & opponent;
+			for (bb_bits_t land = step ? bb_steps[bb_first(step)][dir] : 0; land & ~occupied; land = bb_steps[bb_first(land)][dir]) {
+				steps[count] = step;
+				lands[count++] = land;
+			}
+			continue;
+		}
+#endif
+		if (!king && !bb_man_captures(color, dir))
+			continue;
+		bb_bits_t step = bb_steps[square][dir] & opponent;
+		bb_bits_t land = bb_jumps[square][dir] & ~occupied;
+		if (step && land) {
+			steps[count] = step;
+			lands[count++] = land;
+		}
+	}
+	return count;
+}
+
+// The most pieces the chain of the piece that left `origin` can still take
+// from `square`. `occupied` has the piece on `square` and the pieces taken so
+// far, `opponent` doesn't have them.
+static int longest_chain(chain_memo_t *memo, piece_color_t color, bool king, int origin, int square,
+		bb_bits_t occupied, bb_bits_t opponent, bb_bits_t captures) {
+	bool found;
+	chain_entry_t *entry = chain_memo_probe(memo, origin, square, captures, &found);
+	if (found)
+		return entry->longest;
+
+	bb_bits_t steps[BB_SQUARE_HOPS], lands[BB_SQUARE_HOPS];
+	int count = capture_hops(square, occupied, opponent, king, color, steps, lands);
+	int result = 0;
+	for (int i = 0; i < count; i++) {
+		int length = 1 + longest_chain(memo, color, king, origin, bb_first(lands[i]),
+			(occupied & ~BB_BIT(square)) | lands[i], opponent & ~steps[i], captures | steps[i]);
+		if (length > result)
+			result = length;
+	}
+	// the chains after this state may have taken the entry, so it is looked up again
+	entry = chain_memo_probe(memo, origin, square, captures, &found);
+	entry->captures = captures;
+	entry->generation = memo->generation;
+	entry->origin = (int8_t)origin;
+	entry->square = (int8_t)square;
+	entry->longest = (int8_t)result;
+	return result;
+}
+
+// Keeps in `jumpers` only the pieces with the longest chains and returns how
+// many pieces those take
+static int longest_jumpers(chain_memo_t *memo, const bitboard_t *bb, piece_color_t color, bb_bits_t *jumpers) {
+	bb_bits_t occupied = bb->color[PIECE_BLACK] | bb->color[PIECE_WHITE];
+	bb_bits_t opponent = bb->color[bb_other(color)];
+	int result = 0;
+	bb_bits_t longest = 0;
+	for (bb_bits_t rest = *jumpers; rest; rest &= rest - 1) {
+		int square = bb_first(rest);
+		int length = longest_chain(memo, color, (bb->kings >> square) & 1, square, square, occupied, opponent, 0);
+		if (length > result) {
+			result = length;
+			longest = 0;
+		}
+		if (length == result)
+			longest |= BB_BIT(square);
+	}
+	*jumpers = longest;
+	return result;
+}
+
+// Pieces of the color that can start one of the longest capture chains
+extern bb_bits_t bb_longest_jumpers(const bitboard_t *bb, piece_color_t color) {
+	bb_bits_t result = bb_jumpers(bb, color);
+	if (result) {
+		longest_jumpers(chain_memo_start(), bb, color, &result);
+	}
+	return result;
+}
+#endif
+
+// Pieces of the color that have at least one non-capture move
+extern bb_bits_t bb_movers(const bitboard_t *bb, piece_color_t color) {
+	bb_bits_t empty = ~(bb->color[PIECE_BLACK] | bb->color[PIECE_WHITE]);
+	bb_bits_t own = bb->color[color];
+	bb_bits_t kings = own & bb->kings;
+	bb_bits_t result = 0;
+	for (int dir = 0; dir < 4; dir++) {
+		bb_bits_t movers = bb_forward(color, dir) ? own : kings;
+		result |= movers & bb_shift(empty, BB_OPPOSITE(dir));
+	}
+	return result;
+}
+
+// Pieces of the color that have at least one capture. Flying kings are
+// looked at one by one, along their diagonals.
+extern bb_bits_t bb_jumpers(const bitboard_t *bb, piece_color_t color) {
+	bb_bits_t occupied = bb->color[PIECE_BLACK] | bb->color[PIECE_WHITE];
+	bb_bits_t empty = ~occupied;
+	bb_bits_t own = bb->color[color];
+	bb_bits_t opponent = bb->color[bb_other(color)];
+	bb_bits_t kings = own & bb->kings;
+	bb_bits_t result = 0;
+	for (int dir = 0; dir < 4; dir++) {
+		bb_dir_t back = BB_OPPOSITE(dir);
+#if RULES_FLYING_KINGS
+		bb_bits_t movers = bb_man_captures(color, dir) ? own & ~kings : 0;
+#else
+		bb_bits_t movers = bb_man_captures(color, dir) ? own : kings;
+#endif
+		result |= movers & bb_shift(bb_shift(empty, back) & opponent, back);
+	}
+#if RULES_FLYING_KINGS
+	for (bb_bits_t rest = kings; rest; rest &= rest - 1) {
+		int square = bb_first(rest);
+		if (king_can_capture(square, occupied, opponent))
+			result |= BB_BIT(square);
+	}
+#endif
+	return result;
+}
+
+// Same contract as find_local_moves: if the piece at the square has any
+// capture, only the captures are returned. The hops are listed in the same
+// direction order the grid implementation uses. The pieces in `captured`
+// were taken earlier in the chain, with RULES_CAPTURED_STAY they are still
+// on the board but can't be taken again. With RULES_MAXIMUM_CAPTURE only the
+// captures that go on to the longest chain are returned.
+extern int bb_square_hops(const bitboard_t *bb, int square, bb_bits_t captured, bb_hop_t hops[BB_SQUARE_HOPS]) {
+	static const bb_dir_t dir_order[4] = { BB_DOWN_RIGHT, BB_DOWN_LEFT, BB_UP_RIGHT, BB_UP_LEFT };
+
+	bb_bits_t bit = BB_BIT(square);
+	bb_bits_t occupied = bb->color[PIECE_BLACK] | bb->color[PIECE_WHITE];
+	piece_color_t color = (bb->color[PIECE_WHITE] & bit) ? PIECE_WHITE : PIECE_BLACK;
+	bb_bits_t opponent = bb->color[bb_other(color)] & ~captured;
+	bool king = (bb->kings & bit) != 0;
+
+	int count = 0;
+	bool has_capture = false;
+	for (int i = 0; i < 4; i++) {
+		bb_dir_t dir = dir_order[i];
+#if RULES_FLYING_KINGS
+		if (king) {
+			bb_bits_t step = first_blocker(square, dir, occupied) & opponent;
+			for (bb_bits_t land = step ? bb_steps[bb_first(step)][dir] : 0; land & ~occupied; land = bb_steps[bb_first(land)][dir]) {
+				if (!has_capture) {
+					has_capture = true;
+					count = 0;
+				}
+				bb_hop_t hop = { (int8_t)bb_first(land), (int8_t)bb_first(step) };
+				hops[count++] = hop;
+			}
+			for (bb_bits_t to = bb_steps[square][dir]; !has_capture && (to & ~occupied); to = bb_steps[bb_first(to)][dir]) {
+				bb_hop_t hop = { (int8_t)bb_first(to), -1 };
+				hops[count++] = hop;
+			}
+			continue;
+		}
+#endif
+		if (!king && !bb_man_captures(color, dir))
+			continue;
+		bb_bits_t step = bb_steps[square][dir];
+		bb_bits_t land = bb_jumps[square][dir];
+		if ((step & opponent) && (land & ~occupied)) {
+			if (!has_capture) {
+				has_capture = true;
+				count = 0;
+			}
+			bb_hop_t hop = { (int8_t)bb_first(land), (int8_t)bb_first(step) };
+			hops[count++] = hop;
+		} else if ((step & ~occupied) && !has_capture && (king || bb_forward(color, dir))) {
+			bb_hop_t hop = { (int8_t)bb_first(step), -1 };
+			hops[count++] = hop;
+		}
+	}
+#if RULES_MAXIMUM_CAPTURE
+	if (has_capture) {
+		chain_memo_t *memo = chain_memo_start();
+		int lengths[BB_SQUARE_HOPS];
+		int longest = 0;
+		for (int i = 0; i < count; i++) {
+			bb_bits_t step = BB_BIT(hops[i].capture);
+			bb_bits_t land = BB_BIT(hops[i].to);
+			lengths[i] = longest_chain(memo, color, king, square, hops[i].to,
+				(occupied & ~bit) | land, opponent & ~step, captured | step);
+			if (lengths[i] > longest)
+				longest = lengths[i];
+		}
+		int kept = 0;
+		for (int i = 0; i < count; i++) {
+			if (lengths[i] == longest)
+				hops[kept++] = hops[i];
+		}
+		count = kept;
+	}
+#endif
+	return count;
+}
+
+// Moves the piece and crowns men reaching the opposite side, on a capture
+// only with RULES_CROWN_IN_CHAIN. The captured piece is taken off unless
+// RULES_CAPTURED_STAY keeps it until the chain ends. The hop is not validated.
+extern void bb_apply_hop(bitboard_t *bb, int from, bb_hop_t hop) {
+	bb_bits_t from_bit = BB_BIT(from);
+	bb_bits_t to_bit = BB_BIT(hop.to);
+	piece_color_t color = (bb->color[PIECE_WHITE] & from_bit) ? PIECE_WHITE : PIECE_BLACK;
+
+	bb->color[color] ^= from_bit | to_bit;
+	if (bb->kings & from_bit)
+		bb->kings ^= from_bit | to_bit;
+	else if ((to_bit & (color == PIECE_BLACK ? BB_ROW_TOP : BB_ROW_BOTTOM)) && (RULES_CROWN_IN_CHAIN || hop.capture < 0))
+		bb->kings |= to_bit;
+
+	if (hop.capture >= 0 && !RULES_CAPTURED_STAY) {
+		bb_bits_t cap_bit = BB_BIT(hop.capture);
+		bb->color[bb_other(color)] &= ~cap_bit;
+		bb->kings &= ~cap_bit;
+	}
+}
+
+typedef struct {
+	bb_move_t *moves;
+	int count;
+	piece_color_t color;
+	bb_bits_t promotion_row;
+#if RULES_MAXIMUM_CAPTURE
+	chain_memo_t *memo;
+	int longest; // captures of the chains that can be played
+#endif
+} move_list_t;
+
+static void add_move(move_list_t *list, const bb_move_t *move) {
+#if RULES_MAXIMUM_CAPTURE
+	// a chain taking the same pieces to the same square in another order is
+	// the same move
+	for (int i = 0; move->captures && i < list->count; i++) {
+		const bb_move_t *other = list->moves + i;
+		if (other->captures == move->captures && other->path[0] == move->path[0] && other->path[other->length] == move->path[move->length])
+			return;
+	}
+#endif
+	assert(list->count < BB_MAX_MOVES);
+	list->moves[list->count++] = *move;
+}
+
+static void add_capture_chains(move_list_t *list, bb_move_t *move, bb_bits_t occupied, bb_bits_t opponent, bool king);
+
+// Takes the piece on `step` landing on `land` and goes on from there
+static void add_capture(move_list_t *list, const bb_move_t *move, bb_bits_t occupied, bb_bits_t opponent, bb_bits_t step, bb_bits_t land, bool king) {
+	bb_move_t next = *move;
+	next.path[++next.length] = (uint8_t)bb_first(land);
+	next.captures |= step;
+	bool crown = RULES_CROWN_IN_CHAIN && !king && (land & list->promotion_row);
+	next.crown |= crown;
+	bb_bits_t left = BB_BIT(move->path[move->length]) | (RULES_CAPTURED_STAY ? 0 : step);
+#if RULES_MAXIMUM_CAPTURE
+	// only the branches that can still make a longest chain
+	if (next.length + longest_chain(list->memo, list->color, king, next.path[0], bb_first(land),
+			(occupied & ~left) | land, opponent & ~step, next.captures) < list->longest)
+		return;
+#endif
+	add_capture_chains(list, &next, (occupied & ~left) | land, opponent & ~step, king || crown);
+}
+
+// Extend the capture chain in `move` from its last square. The captured pieces
+// are taken off `opponent` as they are jumped, like perform_move does, and
+// off `occupied` too unless RULES_CAPTURED_STAY. With RULES_CROWN_IN_CHAIN a
+// man crowned in the middle of the chain goes on capturing as a king,
+// otherwise it is only crowned if the chain ends on the far row.
+static void add_capture_chains(move_list_t *list, bb_move_t *move, bb_bits_t occupied, bb_bits_t opponent, bool king) {
+	int square = move->path[move->length];
+	bool extended = false;
+	for (int dir = 0; dir < 4; dir++) {
+#if RULES_FLYING_KINGS
+		if (king) {
+			bb_bits_t step = first_blocker(square, dir, occupied) & opponent;
+			for (bb_bits_t land = step ? bb_steps[bb_first(step)][dir] : 0; land & ~occupied; land = bb_steps[bb_first(land)][dir]) {
+				add_capture(list, move, occupied, opponent, step, land, true);
+				extended = true;
+			}
+			continue;
+		}
+#endif
+		if (!king && !bb_man_captures(list->color, dir))
+			continue;
+		bb_bits_t step = bb_steps[square][dir] & opponent;
+		bb_bits_t land = bb_jumps[square][dir] & ~occupied;
+		if (!step || !land)
+			continue;
+		add_capture(list, move, occupied, opponent, step, land, king);
+		extended = true;
+	}
+	if (!extended && move->length > 0) {
+		if (!RULES_CROWN_IN_CHAIN)
+			move->crown = !king && (BB_BIT(square) & list->promotion_row);
+		add_move(list, move);
+	}
+}
+
+// List every complete move of the color. When a capture is available only the
+// capture chains are listed, each one ending where no further capture exists.
+// With RULES_MAXIMUM_CAPTURE the longest chain of each piece is found first,
+// each state of a chain once, and only the chains as long as the longest of
+// all are followed.
+extern int bb_generate_moves(const bitboard_t *bb, piece_color_t color, bb_move_t moves[BB_MAX_MOVES]) {
+	move_list_t list = { moves, 0, color, (color == PIECE_BLACK) ? BB_ROW_TOP : BB_ROW_BOTTOM };
+	bb_bits_t occupied = bb->color[PIECE_BLACK] | bb->color[PIECE_WHITE];
+	bb_bits_t own = bb->color[color];
+	bb_bits_t kings = own & bb->kings;
+
+	bb_bits_t jumpers = bb_jumpers(bb, color);
+	if (jumpers) {
+#if RULES_MAXIMUM_CAPTURE
+		list.memo = chain_memo_start();
+		list.longest = longest_jumpers(list.memo, bb, color, &jumpers);
+#endif
+		for (; jumpers; jumpers &= jumpers - 1) {
+			int square = bb_first(jumpers);
+			bb_move_t move = {0};
+			move.path[0] = (uint8_t)square;
+			add_capture_chains(&list, &move, occupied, bb->color[bb_other(color)], (kings >> square) & 1);
+		}
+	} else {
+		for (int dir = 0; dir < 4; dir++) {
+#if RULES_FLYING_KINGS
+			bb_bits_t movers = bb_forward(color, dir) ? own & ~kings : 0; // kings slide below
+#else
+			bb_bits_t movers = bb_forward(color, dir) ? own : kings;
+#endif
+			bb_bits_t targets = bb_shift(movers, dir) & ~occupied;
+			for (; targets; targets &= targets - 1) {
+				bb_bits_t to_bit = targets & -targets;
+				bb_move_t move = {0};
+				move.path[0] = (uint8_t)bb_first(bb_shift(to_bit, BB_OPPOSITE(dir)));
+				move.path[1] = (uint8_t)bb_first(to_bit);
+				move.length = 1;
+				move.crown = !(kings & BB_BIT(move.path[0])) && (to_bit & list.promotion_row);
+				add_move(&list, &move);
+			}
+		}
+#if RULES_FLYING_KINGS
+		for (bb_bits_t rest = kings; rest; rest &= rest - 1) {
+			int square = bb_first(rest);
+			for (int dir = 0; dir < 4; dir++) {
+				for (bb_bits_t to = bb_steps[square][dir]; to & ~occupied; to = bb_steps[bb_first(to)][dir]) {
+					bb_move_t move = {0};
+					move.path[0] = (uint8_t)square;
+					move.path[1] = (uint8_t)bb_first(to);
+					move.length = 1;
+					add_move(&list, &move);
+				}
+			}
+		}
+#endif
+	}
+	return list.count;
+}
+
+// Plays a whole move generated by bb_generate_moves. The move is not validated.
+extern void bb_apply_move(bitboard_t *bb, const bb_move_t *move) {
+	bb_bits_t from_bit = BB_BIT(move->path[0]);
+	bb_bits_t to_bit = BB_BIT(move->path[move->length]);
+	piece_color_t color = (bb->color[PIECE_WHITE] & from_bit) ? PIECE_WHITE : PIECE_BLACK;
+	bool king = (bb->kings & from_bit) || move->crown;
+
+	bb->color[color] &= ~from_bit;
+	bb->color[color] |= to_bit;
+	bb->kings &= ~(from_bit | move->captures);
+	if (king)
+		bb->kings |= to_bit;
+	bb->color[bb_other(color)] &= ~move->captures;
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+#include "rules.h"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+/*
+ * Bitboard representation of the playable squares, 32 of them in a 32 bit
+ * word on the 8x8 board and 50 in a 64 bit word on the 10x10 one. Squares
+ * are numbered row by row, BB_HALF per row (square = row * BB_HALF + col / 2):
+ *
+ *   row 0:   0 .  1 .  2 .  3 .
+ *   row 1:   .  4 .  5 .  6 .  7
+ *   row 2:   8 .  9 . 10 . 11 .
+ *   ...
+ *   row 7:   . 28 . 29 . 30 . 31
+ *
+ * "Down" means increasing rows, the direction white men move to.
+ */
+
+#define BB_HALF (RULES_BOARD_SIZE / 2) // squares in a row
+#define BB_SQUARES (RULES_BOARD_SIZE * BB_HALF)
+
+#if RULES_BOARD_SIZE == 10
+typedef uint64_t bb_bits_t;
+	#define BB_EVEN_ROWS   0x00001F07C1F07C1Full
+	#define BB_ODD_ROWS    0x0003E0F83E0F83E0ull
+	#define BB_LEFT_EDGE   0x0000210842108421ull // first square of each row
+	#define BB_RIGHT_EDGE  0x0002108421084210ull
+	#define BB_ROW_TOP     0x000000000000001Full
+	#define BB_ROW_BOTTOM  0x0003E00000000000ull
+#else
+typedef uint32_t bb_bits_t;
+	#define BB_EVEN_ROWS   0x0F0F0F0Fu
+	#define BB_ODD_ROWS    0xF0F0F0F0u
+	#define BB_LEFT_EDGE   0x11111111u
+	#define BB_RIGHT_EDGE  0x88888888u
+	#define BB_ROW_TOP     0x0000000Fu
+	#define BB_ROW_BOTTOM  0xF0000000u
+#endif
+
+#define BB_BIT(square) ((bb_bits_t)1 << (square))
+
+typedef enum {
+	BB_DOWN_RIGHT,
+	BB_DOWN_LEFT,
+	BB_UP_RIGHT,
+	BB_UP_LEFT,
+} bb_dir_t;
+
+// the opposite direction of d is always (3 - d)
+#define BB_OPPOSITE(dir) ((bb_dir_t)(3 - (dir)))
+
+typedef struct {
+	bb_bits_t color[2]; // indexed by piece_color_t
+	bb_bits_t kings;
+} bitboard_t;
+
+typedef struct {
+	int8_t to;
+	int8_t capture; // -1 when the hop isn't a capture
+} bb_hop_t;
+
+#define BB_MAX_HOPS RULES_PIECES // a chain can't capture more than all the opponent pieces
+// Moves of a position. At most about 70 were found on the 8x8 board, on
+// 10x10 flying kings reach a few hundred capture chains.
+#if RULES_BOARD_SIZE == 10
+	#define BB_MAX_MOVES 1024
+#else
+	#define BB_MAX_MOVES 128
+#endif
+
+// Hops bb_square_hops can find for a piece, a flying king has a whole
+// diagonal in each direction
+#if RULES_FLYING_KINGS
+	#define BB_SQUARE_HOPS (4 * (RULES_BOARD_SIZE - 1))
+#else
+	#define BB_SQUARE_HOPS 4
+#endif
+
+// A complete turn: a single step or a whole capture chain
+typedef struct {
+	bb_bits_t captures; // squares of the captured pieces
+	uint8_t path[BB_MAX_HOPS + 1]; // squares visited, path[0] is the origin
+	uint8_t length; // number of hops
+	bool crown; // a man reaches the opposite side during the move
+} bb_move_t;
+
+// Move every bit one diagonal step, bits that would leave the board are
+// dropped. Even rows start at the left edge and odd rows one column in, so
+// each direction shifts the two kinds of rows by a different amount. Macros
+// so they can also build constant tables.
+#define BB_SHIFT_DOWN_RIGHT(b) ((((b) & BB_EVEN_ROWS) << BB_HALF) \
+	| (((b) & (BB_ODD_ROWS & ~(BB_RIGHT_EDGE | BB_ROW_BOTTOM))) << (BB_HALF + 1)))
+#define BB_SHIFT_DOWN_LEFT(b)  ((((b) & (BB_EVEN_ROWS & ~BB_LEFT_EDGE)) << (BB_HALF - 1)) \
+	| (((b) & (BB_ODD_ROWS & ~BB_ROW_BOTTOM)) << BB_HALF))
+#define BB_SHIFT_UP_RIGHT(b)   ((((b) & (BB_EVEN_ROWS & ~BB_ROW_TOP)) >> BB_HALF) \
+	| (((b) & (BB_ODD_ROWS & ~BB_RIGHT_EDGE)) >> (BB_HALF - 1)))
+#define BB_SHIFT_UP_LEFT(b)    ((((b) & (BB_EVEN_ROWS & ~(BB_LEFT_EDGE | BB_ROW_TOP))) >> (BB_HALF + 1)) \
+	| (((b) & BB_ODD_ROWS) >> BB_HALF))
+
+static inline bb_bits_t bb_shift(bb_bits_t b, bb_dir_t dir) {
+	switch (dir) {
+		case BB_DOWN_RIGHT: return BB_SHIFT_DOWN_RIGHT(b);
+		case BB_DOWN_LEFT:  return BB_SHIFT_DOWN_LEFT(b);
+		case BB_UP_RIGHT:   return BB_SHIFT_UP_RIGHT(b);
+		case BB_UP_LEFT:    return BB_SHIFT_UP_LEFT(b);
+	}
+	return 0;
+}
+
+// For each square and direction, the bit of the square one step away (which
+// is also the one jumped over by a capture) and of the square a capture lands
+// on. Off the board the bit is 0, so the edges need no test of their own.
+extern const bb_bits_t bb_steps[BB_SQUARES][4];
+extern const bb_bits_t bb_jumps[BB_SQUARES][4];
+
+#if RULES_BOARD_SIZE == 10
+static inline int bb_first(bb_bits_t b) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, b);
+	return (int)index;
+#else
+	return __builtin_ctzll(b);
+#endif
+}
+
+static inline int bb_count(bb_bits_t b) {
+#ifdef _MSC_VER
+	return (int)__popcnt64(b);
+#else
+	return __builtin_popcountll(b);
+#endif
+}
+#else
+static inline int bb_first(bb_bits_t b) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, b);
+	return (int)index;
+#else
+	return __builtin_ctz(b);
+#endif
+}
+
+static inline int bb_count(bb_bits_t b) {
+#ifdef _MSC_VER
+	return (int)__popcnt(b);
+#else
+	return __builtin_popcount(b);
+#endif
+}
+#endif
+
+static inline piece_color_t bb_other(piece_color_t color) {
+	return (color == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+}
+
+// Directions a man of the given color is allowed to move to
+static inline bool bb_forward(piece_color_t color, bb_dir_t dir) {
+	return (color == PIECE_WHITE) == (dir == BB_DOWN_RIGHT || dir == BB_DOWN_LEFT);
+}
+
+// Directions a man of the given color is allowed to capture to
+static inline bool bb_man_captures(piece_color_t color, bb_dir_t dir) {
+	return RULES_MEN_CAPTURE_BACKWARD || bb_forward(color, dir);
+}
+
+int bb_square(cell_pos_t pos);
+cell_pos_t bb_cell(int square);
+
+bb_bits_t bb_movers(const bitboard_t *bb, piece_color_t color);
+bb_bits_t bb_jumpers(const bitboard_t *bb, piece_color_t color);
+#if RULES_MAXIMUM_CAPTURE
+bb_bits_t bb_longest_jumpers(const bitboard_t *bb, piece_color_t color);
+#endif
+int bb_square_hops(const bitboard_t *bb, int square, bb_bits_t captured, bb_hop_t hops[BB_SQUARE_HOPS]);
+void bb_apply_hop(bitboard_t *bb, int from, bb_hop_t hop);
+int bb_generate_moves(const bitboard_t *bb, piece_color_t color, bb_move_t moves[BB_MAX_MOVES]);
+void bb_apply_move(bitboard_t *bb, const bb_move_t *move);
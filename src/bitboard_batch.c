@@ -0,0 +1,122 @@
+#include "bitboard_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define HAVE_AVX2_KERNEL
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define TARGET_AVX2 // MSVC takes AVX2 intrinsics without a compiler flag
+	#else
+		#define TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+static void masks_scalar(const bitboard_t *bbs, const piece_color_t *turns, int count, bb_masks_t *masks) {
+	for (int i = 0; i < count; i++) {
+		masks[i].movers = bb_movers(bbs + i, turns[i]);
+		masks[i].jumpers = bb_jumpers(bbs + i, turns[i]);
+	}
+}
+
+#ifdef HAVE_AVX2_KERNEL
+
+// The BB_SHIFT_* macros on eight boards, shifts are the same in every lane
+#define SHIFT_PAIR(b, m1, op1, n1, m2, op2, n2) _mm256_or_si256( \
+	op1(_mm256_and_si256((b), _mm256_set1_epi32((int)(m1))), n1), \
+	op2(_mm256_and_si256((b), _mm256_set1_epi32((int)(m2))), n2))
+#define SHIFT_DOWN_RIGHT(b) SHIFT_PAIR(b, 0x0F0F0F0Fu, _mm256_slli_epi32, 4, 0x00707070u, _mm256_slli_epi32, 5)
+#define SHIFT_DOWN_LEFT(b)  SHIFT_PAIR(b, 0x0E0E0E0Eu, _mm256_slli_epi32, 3, 0x00F0F0F0u, _mm256_slli_epi32, 4)
+#define SHIFT_UP_RIGHT(b)   SHIFT_PAIR(b, 0x0F0F0F00u, _mm256_srli_epi32, 4, 0x70707070u, _mm256_srli_epi32, 3)
+#define SHIFT_UP_LEFT(b)    SHIFT_PAIR(b, 0x0E0E0E00u, _mm256_srli_epi32, 5, 0xF0F0F0F0u, _mm256_srli_epi32, 4)
+
+// The same masks as bb_movers and bb_jumpers, where a color is a lane mask
+// instead of a branch: men of the lanes with white to move go down, the
+// others go up, and kings go both ways.
+TARGET_AVX2 static void masks_avx2(const bitboard_t *bbs, const piece_color_t *turns, int count, bb_masks_t *masks) {
+	const int stride = sizeof(bitboard_t) / sizeof(uint32_t);
+	const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const int *base = (const int *)(bbs + i);
+		__m256i black = _mm256_i32gather_epi32(base + 0, lanes, 4);
+		__m256i white = _mm256_i32gather_epi32(base + 1, lanes, 4);
+		__m256i kings = _mm256_i32gather_epi32(base + 2, lanes, 4);
+		const piece_color_t *t = turns + i;
+		__m256i is_white = _mm256_cmpeq_epi32(
+			_mm256_setr_epi32(t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7]),
+			_mm256_set1_epi32(PIECE_WHITE));
+
+		__m256i own = _mm256_blendv_epi8(black, white, is_white);
+		__m256i opponent = _mm256_blendv_epi8(white, black, is_white);
+		__m256i own_kings = _mm256_and_si256(own, kings);
+		__m256i down = _mm256_blendv_epi8(own_kings, own, is_white);
+		__m256i up = _mm256_blendv_epi8(own, own_kings, is_white);
+		__m256i empty = _mm256_xor_si256(_mm256_or_si256(black, white), _mm256_set1_epi32(-1));
+
+		// a piece can go down if the square down from it is empty, that is if
+		// it is up from an empty square
+		__m256i empty_up = _mm256_or_si256(SHIFT_UP_RIGHT(empty), SHIFT_UP_LEFT(empty));
+		__m256i empty_down = _mm256_or_si256(SHIFT_DOWN_RIGHT(empty), SHIFT_DOWN_LEFT(empty));
+		__m256i movers = _mm256_or_si256(_mm256_and_si256(down, empty_up), _mm256_and_si256(up, empty_down));
+
+		__m256i jump_up = _mm256_or_si256(
+			SHIFT_UP_RIGHT(_mm256_and_si256(SHIFT_UP_RIGHT(empty), opponent)),
+			SHIFT_UP_LEFT(_mm256_and_si256(SHIFT_UP_LEFT(empty), opponent)));
+		__m256i jump_down = _mm256_or_si256(
+			SHIFT_DOWN_RIGHT(_mm256_and_si256(SHIFT_DOWN_RIGHT(empty), opponent)),
+			SHIFT_DOWN_LEFT(_mm256_and_si256(SHIFT_DOWN_LEFT(empty), opponent)));
+		__m256i jumpers = _mm256_or_si256(_mm256_and_si256(down, jump_up), _mm256_and_si256(up, jump_down));
+
+		// interleave into bb_masks_t order: movers and jumpers of lane 0, 1...
+		__m256i low = _mm256_unpacklo_epi32(movers, jumpers); // lanes 0 1 | 4 5
+		__m256i high = _mm256_unpackhi_epi32(movers, jumpers); // lanes 2 3 | 6 7
+		_mm256_storeu_si256((__m256i *)(masks + i), _mm256_permute2x128_si256(low, high, 0x20));
+		_mm256_storeu_si256((__m256i *)(masks + i + 4), _mm256_permute2x128_si256(low, high, 0x31));
+	}
+	masks_scalar(bbs + i, turns + i, count - i, masks + i);
+}
+
+static bool cpu_has_avx2(void) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave || (_xgetbv(0) & 6) != 6) // the OS saves the YMM registers
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+extern bb_kernel_t bb_batch_kernel(void) {
+#ifdef HAVE_AVX2_KERNEL
+	static int avx2 = -1; // computed once, every thread gets the same answer
+	if (avx2 < 0)
+		avx2 = cpu_has_avx2();
+	if (avx2)
+		return BB_KERNEL_AVX2;
+#endif
+	return BB_KERNEL_SCALAR;
+}
+
+extern const char *bb_kernel_name(bb_kernel_t kernel) {
+	return (kernel == BB_KERNEL_AVX2) ? "avx2" : "scalar";
+}
+
+extern void bb_batch_masks_with(bb_kernel_t kernel, const bitboard_t *bbs, const piece_color_t *turns, int count, bb_masks_t *masks) {
+#ifdef HAVE_AVX2_KERNEL
+	if (kernel == BB_KERNEL_AVX2) {
+		masks_avx2(bbs, turns, count, masks);
+		return;
+	}
+#endif
+	masks_scalar(bbs, turns, count, masks);
+}
+
+extern void bb_batch_masks(const bitboard_t *bbs, const piece_color_t *turns, int count, bb_masks_t *masks) {
+	bb_batch_masks_with(bb_batch_kernel(), bbs, turns, count, masks);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "bitboard.h"
+
+#if !RULES_AMERICAN
+	#error "the batch masks only know the U.S. rules"
+#endif
+
+/*
+ * Move masks for many independent positions at once, for self-play and for
+ * checking the moves of many games on a server. With AVX2 the positions are
+ * done eight at a time, one per 32-bit lane; otherwise, and for the last
+ * count % 8 positions, bb_movers and bb_jumpers are called one by one. The
+ * kernel is picked once at run time from what the CPU supports.
+ */
+
+typedef struct {
+	uint32_t movers; // pieces of the side to move with a step to an empty square
+	uint32_t jumpers; // pieces of the side to move with a capture
+} bb_masks_t;
+
+typedef enum { BB_KERNEL_SCALAR, BB_KERNEL_AVX2 } bb_kernel_t;
+
+bb_kernel_t bb_batch_kernel(void); // the best kernel this CPU can run
+const char *bb_kernel_name(bb_kernel_t kernel);
+
+void bb_batch_masks(const bitboard_t *bbs, const piece_color_t *turns, int count, bb_masks_t *masks);
+// Same with the given kernel, which must be supported by the CPU
+void bb_batch_masks_with(bb_kernel_t kernel, const bitboard_t *bbs, const piece_color_t *turns, int count, bb_masks_t *masks);
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "book.h"
+#include "file_map.h"
+#include "zobrist.h"
+
+/*
+ * File layout: a 16 byte header with the entry count, then the entries in 16
+ * bytes each, all numbers little endian. Entries of the same key are sorted
+ * by weight, the heaviest first.
+ */
+
+#define BOOK_MAGIC "NCBK"
+#define BOOK_VERSION 1
+#define HEADER_SIZE 16
+#define ENTRY_SIZE 16
+
+struct _book {
+	file_map_t map;
+	size_t count;
+};
+
+static uint64_t read_le(const uint8_t *p, int bytes) {
+	uint64_t result = 0;
+	for (int i = bytes - 1; i >= 0; i--)
+		result = result << 8 | p[i];
+	return result;
+}
+
+static void write_le(uint8_t *p, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		p[i] = (uint8_t)(value >> (8 * i));
+}
+
+static int compare_moves(const void *a, const void *b) {
+	const book_entry_t *x = a, *y = b;
+	if (x->key != y->key)
+		return (x->key < y->key) ? -1 : 1;
+	if (x->from != y->from)
+		return x->from - y->from;
+	if (x->to != y->to)
+		return x->to - y->to;
+	return (x->captures < y->captures) ? -1 : (x->captures > y->captures);
+}
+
+static int compare_weights(const void *a, const void *b) {
+	const book_entry_t *x = a, *y = b;
+	if (x->key != y->key)
+		return (x->key < y->key) ? -1 : 1;
+	return y->weight - x->weight;
+}
+
+extern bool book_write(const char *path, book_entry_t *entries, size_t count) {
+	qsort(entries, count, sizeof(book_entry_t), compare_moves);
+	size_t merged = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (merged > 0 && compare_moves(entries + merged - 1, entries + i) == 0) {
+			uint32_t weight = (uint32_t)entries[merged - 1].weight + entries[i].weight;
+			entries[merged - 1].weight = (uint16_t)(weight > 0xffff ? 0xffff : weight);
+		} else {
+			entries[merged++] = entries[i];
+		}
+	}
+	qsort(entries, merged, sizeof(book_entry_t), compare_weights);
+
+	FILE *file = fopen(path, "wb");
+	if (!file) {
+		perror(path);
+		return false;
+	}
+	uint8_t header[HEADER_SIZE] = BOOK_MAGIC;
+	header[4] = BOOK_VERSION;
+	write_le(header + 8, merged, 8);
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+	for (size_t i = 0; ok && i < merged; i++) {
+		uint8_t data[ENTRY_SIZE] = {0};
+		write_le(data, entries[i].key, 8);
+		write_le(data + 8, entries[i].captures, 4);
+		data[12] = entries[i].from;
+		data[13] = entries[i].to;
+		write_le(data + 14, entries[i].weight, 2);
+		ok = fwrite(data, sizeof(data), 1, file) == 1;
+	}
+	if (fclose(file) != 0)
+		ok = false;
+	if (!ok)
+		perror(path);
+	return ok;
+}
+
+extern book_t *book_open(const char *path) {
+	book_t *book = calloc(1, sizeof(book_t));
+	if (!book) {
+		perror("ERROR calloc");
+		return 0;
+	}
+	if (!file_map_open(&book->map, path)) {
+		free(book);
+		return 0;
+	}
+	const uint8_t *data = book->map.data;
+	size_t size = book->map.size;
+	if (size < HEADER_SIZE || memcmp(data, BOOK_MAGIC, 4) != 0 || data[4] != BOOK_VERSION
+		|| read_le(data + 8, 8) > (size - HEADER_SIZE) / ENTRY_SIZE) {
+		fprintf(stderr, "ERROR invalid book file: %s\n", path);
+		file_map_close(&book->map);
+		free(book);
+		return 0;
+	}
+	book->count = (size_t)read_le(data + 8, 8);
+	return book;
+}
+
+extern void book_close(book_t *book) {
+	file_map_close(&book->map);
+	free(book);
+}
+
+extern size_t book_size(const book_t *book) {
+	return book->count;
+}
+
+static const uint8_t *book_entry(const book_t *book, size_t index) {
+	return book->map.data + HEADER_SIZE + index * ENTRY_SIZE;
+}
+
+extern bool book_probe(const book_t *book, const bitboard_t *bb, piece_color_t turn, uint32_t random, bb_move_t *move) {
+	uint64_t key = zobrist_hash(bb, turn);
+
+	// first entry with the key
+	size_t low = 0, high = book->count;
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (read_le(book_entry(book, middle), 8) < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	size_t end = low;
+	uint32_t total = 0;
+	while (end < book->count && read_le(book_entry(book, end), 8) == key)
+		total += (uint32_t)read_le(book_entry(book, end++) + 14, 2);
+	if (end == low || total == 0)
+		return false;
+
+	uint32_t pick = random % total;
+	const uint8_t *entry = book_entry(book, low);
+	for (;;) {
+		uint32_t weight = (uint32_t)read_le(entry + 14, 2);
+		if (pick < weight)
+			break;
+		pick -= weight;
+		entry += ENTRY_SIZE;
+	}
+
+	// the key can collide, so the move has to be one of the position
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = bb_generate_moves(bb, turn, moves);
+	for (int i = 0; i < count; i++) {
+		if (moves[i].path[0] == entry[12] && moves[i].path[moves[i].length] == entry[13]
+			&& moves[i].captures == (uint32_t)read_le(entry + 8, 4)) {
+			*move = moves[i];
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bitboard.h"
+
+#if RULES_BOARD_SIZE != 8
+	#error "book entries store the captures of the 8x8 board in 32 bits"
+#endif
+
+/*
+ * Opening book: a file of entries sorted by the zobrist key of the position,
+ * one for each move played there in the games the book was built from (see
+ * bookgen.c). The file is mapped read-only and searched in place.
+ */
+
+typedef struct {
+	uint64_t key;
+	uint32_t captures; // tells apart chains with the same ends
+	uint8_t from, to; // squares
+	uint16_t weight; // how many games played the move
+} book_entry_t;
+
+typedef struct _book book_t;
+
+// Sorts the entries and merges the ones of the same move before writing
+bool book_write(const char *path, book_entry_t *entries, size_t count);
+
+book_t *book_open(const char *path);
+void book_close(book_t *book);
+size_t book_size(const book_t *book);
+
+// Picks one of the book moves of the position, with a chance proportional to
+// its weight: random 0 always gives the most played one
+bool book_probe(const book_t *book, const bitboard_t *bb, piece_color_t turn, uint32_t random, bb_move_t *move);
@@ -0,0 +1,92 @@
+/*
+ * Builds an opening book from games read on stdin, one game per line, as
+ * moves from the initial position written like game_parse_move reads them:
+ *
+ *   22-18 11-15 18x11 8x15 ...
+ *
+ * Move numbers ("1.") and results ("1-0", "0-1", "1/2-1/2", "*") are skipped
+ * and "#" starts a comment line. Only the first MAX_PLIES turns of each game
+ * go into the book.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "book.h"
+#include "game.h"
+
+#define DEFAULT_MAX_PLIES 16
+#define MAX_LINE 4096
+
+static bool skip_token(const char *token) {
+	static const char *results[] = { "1-0", "0-1", "1/2-1/2", "*" };
+	for (int i = 0; i < ARRAY_SIZE(results); i++) {
+		if (strcmp(token, results[i]) == 0)
+			return true;
+	}
+	return token[strlen(token) - 1] == '.';
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2 || argc > 3 || (argc == 3 && atoi(argv[2]) < 1)) {
+		fprintf(stderr,
+			"Usage:\n"
+			"    %s OUTPUT [MAX_PLIES] < GAMES\n"
+			"\n"
+			"MAX_PLIES defaults to %d.\n",
+			argv[0], DEFAULT_MAX_PLIES
+		);
+		return 1;
+	}
+	int max_plies = (argc == 3) ? atoi(argv[2]) : DEFAULT_MAX_PLIES;
+
+	book_entry_t *entries = 0;
+	size_t count = 0, capacity = 0;
+	int games = 0;
+	char line[MAX_LINE];
+	for (int line_number = 1; fgets(line, sizeof(line), stdin); line_number++) {
+		if (line[0] == '#')
+			continue;
+		game_state_t game;
+		game_init(&game);
+		int plies = 0;
+		for (char *token = strtok(line, " \t\r\n"); token && plies < max_plies; token = strtok(0, " \t\r\n")) {
+			if (skip_token(token))
+				continue;
+			bb_move_t move;
+			if (!game_parse_move(&game, token, &move)) {
+				fprintf(stderr, "line %d: invalid move %s, skipping the rest of the game\n", line_number, token);
+				break;
+			}
+			if (count == capacity) {
+				capacity = capacity ? capacity * 2 : 1024;
+				book_entry_t *grown = realloc(entries, capacity * sizeof(book_entry_t));
+				if (!grown) {
+					perror("ERROR realloc");
+					return 1;
+				}
+				entries = grown;
+			}
+			book_entry_t *entry = entries + count++;
+			entry->key = game.hash;
+			entry->captures = move.captures;
+			entry->from = move.path[0];
+			entry->to = move.path[move.length];
+			entry->weight = 1;
+
+			perform_turn(&game, &move);
+			plies++;
+		}
+		if (plies > 0)
+			games++;
+	}
+
+	if (!book_write(argv[1], entries, count))
+		return 1;
+	book_t *book = book_open(argv[1]);
+	printf("games\tmoves\tentries\n%d\t%zu\t%zu\n", games, count, book ? book_size(book) : 0);
+	if (book)
+		book_close(book);
+	free(entries);
+	return 0;
+}
@@ -1,6 +1,11 @@
 #pragma once
 
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
 typedef struct {
 	int row;
 	int col;
 } cell_pos_t;
+
+// red pieces start at bottom side of the board, whites at top
+typedef enum { PIECE_BLACK, PIECE_WHITE } piece_color_t;
@@ -0,0 +1,370 @@
+/*
+ * The engine without a window, driven one line at a time through stdin and
+ * answering on stdout, for tournaments and analysis tools:
+ *
+ *   protocol                 -> "id name ...", then "protocolok"
+ *   isready                  -> "readyok" once the commands before are done
+ *   newgame                  forgets what the last searches stored
+ *   setoption NAME VALUE     Hash (MB), Threads, MultiPV (lines to report),
+ *                            Tablebases (a directory) or Network (a weights
+ *                            file, see nn.h, the handcrafted evaluation is
+ *                            used when it can't be loaded), Search
+ *                            (alphabeta or mcts, see mcts.h)
+ *   position startpos|fen FEN [moves MOVE...]
+ *   go [depth N] [nodes N] [movetime MS] [btime MS] [wtime MS]
+ *      [binc MS] [winc MS] [infinite] [ponder]
+ *   ponderhit                the move pondered on was played, the clock starts
+ *   stop                     ends the search
+ *   quit
+ *
+ * FENs and moves are written as game_load_fen and game_parse_move read
+ * them. After each iteration a search prints a line for each of its MultiPV
+ * lines, numbered K from the best: "info depth D multipv K score S nodes N
+ * nps N time MS pv MOVE...", where S is "cp N", "win N" or "loss N" (in
+ * plies) or "tbwin N" or "tbloss N" (plies to a tablebase position). It
+ * ends with "bestmove MOVE [ponder MOVE]", or "bestmove none" when the side
+ * to move has lost. An infinite or ponder search holds its bestmove until a
+ * stop or ponderhit.
+ *
+ * The tree search takes its arena from Hash and counts nodes in go as
+ * playouts, it ignores depth and MultiPV. It prints a single line when it
+ * ends: "info playouts N nodes N pps N time MS winrate W pv MOVE".
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "game.h"
+#include "mcts.h"
+#include "search.h"
+#include "thread.h"
+
+#define DEFAULT_HASH_MB 64
+#define MAX_LINE 8192
+
+static struct {
+	game_state_t game;
+	tt_t *tt;
+	tablebase_t *tb;
+	nn_t *nn;
+	int hash_mb;
+	int threads;
+	int multipv;
+	bool mcts; // Search is the tree search
+
+	search_limits_t limits;
+	search_control_t control;
+	thread_t *thread;
+	bool infinite;
+	bool held; // the search is over but its bestmove waits for stop or ponderhit
+	search_result_t result;
+} engine;
+
+static volatile int output_lock;
+
+static void say(const char *format, ...) {
+	thread_spin_lock(&output_lock);
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	putchar('\n');
+	fflush(stdout);
+	thread_spin_unlock(&output_lock);
+}
+
+static void format_score(int score, char *text, size_t size) {
+	if (score > SCORE_WIN - SEARCH_MAX_PLY)
+		snprintf(text, size, "win %d", SCORE_WIN - score);
+	else if (score < -SCORE_WIN + SEARCH_MAX_PLY)
+		snprintf(text, size, "loss %d", SCORE_WIN + score);
+	else if (score > SCORE_TB_WIN - SEARCH_MAX_PLY)
+		snprintf(text, size, "tbwin %d", SCORE_TB_WIN - score);
+	else if (score < -SCORE_TB_WIN + SEARCH_MAX_PLY)
+		snprintf(text, size, "tbloss %d", SCORE_TB_WIN + score);
+	else
+		snprintf(text, size, "cp %d", score);
+}
+
+static void report(const search_result_t *progress, void *data) {
+	double nps = (progress->seconds > 0) ? progress->nodes / progress->seconds : 0;
+	for (int n = 0; n < progress->line_count; n++) {
+		const search_line_t *line = progress->lines + n;
+		char score[32];
+		char pv[SEARCH_MAX_PV * GAME_MOVE_TEXT_SIZE] = "";
+		format_score(line->score, score, sizeof(score));
+		for (int i = 0; i < line->pv_length; i++) {
+			char move[GAME_MOVE_TEXT_SIZE];
+			game_format_move(line->pv + i, move);
+			if (i > 0)
+				strcat(pv, " ");
+			strcat(pv, move);
+		}
+		say("info depth %d multipv %d score %s nodes %llu nps %.0f time %.0f pv %s", progress->depth, n + 1, score,
+			(unsigned long long)progress->nodes, nps, progress->seconds * 1000, pv);
+	}
+}
+
+static void say_bestmove(const search_result_t *result) {
+	if (!result->found) {
+		say("bestmove none");
+		return;
+	}
+	char best[GAME_MOVE_TEXT_SIZE], ponder[GAME_MOVE_TEXT_SIZE];
+	game_format_move(&result->best_move, best);
+	if (result->ponder_found) {
+		game_format_move(&result->ponder_move, ponder);
+		say("bestmove %s ponder %s", best, ponder);
+	} else {
+		say("bestmove %s", best);
+	}
+}
+
+// The tree search with the limits of go, its result as the one of search
+static search_result_t run_mcts(void) {
+	const search_limits_t *limits = &engine.limits;
+	// the tree search has no iterations to stop between, it plays out to the target
+	search_time_t time = search_move_time(limits);
+	mcts_limits_t mcts_limits = { (time.target > 0) ? time.target : time.hard, limits->nodes, limits->threads,
+		engine.hash_mb, limits->control };
+	mcts_result_t mcts = mcts_search(&engine.game.bitboard, engine.game.current_turn, &mcts_limits);
+
+	search_result_t result = {0};
+	result.found = mcts.found;
+	result.best_move = mcts.best_move;
+	result.nodes = mcts.nodes;
+	result.seconds = mcts.seconds;
+	if (mcts.found) {
+		char move[GAME_MOVE_TEXT_SIZE];
+		game_format_move(&mcts.best_move, move);
+		say("info playouts %llu nodes %llu pps %.0f time %.0f winrate %.3f pv %s", (unsigned long long)mcts.playouts,
+			(unsigned long long)mcts.nodes, (mcts.seconds > 0) ? mcts.playouts / mcts.seconds : 0, mcts.seconds * 1000,
+			mcts.win_rate, move);
+	}
+	return result;
+}
+
+static int search_proc(void *data) {
+	search_result_t result = engine.mcts ? run_mcts()
+		: search(&engine.game.bitboard, engine.game.current_turn, &engine.limits, engine.tt, engine.tb);
+	// the output lock also keeps stop and ponderhit from missing the hold
+	thread_spin_lock(&output_lock);
+	engine.result = result;
+	engine.held = !thread_atomic_get(&engine.control.stop) &&
+		(engine.infinite || thread_atomic_get(&engine.control.pondering));
+	thread_spin_unlock(&output_lock);
+	if (!engine.held)
+		say_bestmove(&result);
+	return 0;
+}
+
+// Ends the running search, if any, and prints a bestmove it held back
+static void stop_search(void) {
+	if (!engine.thread)
+		return;
+	thread_atomic_set(&engine.control.stop, 1);
+	thread_join(engine.thread);
+	engine.thread = 0;
+	if (engine.held) {
+		engine.held = false;
+		say_bestmove(&engine.result);
+	}
+}
+
+static void ponderhit(void) {
+	if (!engine.thread)
+		return;
+	thread_spin_lock(&output_lock);
+	thread_atomic_set(&engine.control.pondering, 0);
+	bool held = engine.held && !engine.infinite;
+	thread_spin_unlock(&output_lock);
+	if (held)
+		stop_search();
+}
+
+static void set_position(char *args) {
+	char *token = strtok(args, " \t");
+	if (token && strcmp(token, "startpos") == 0) {
+		game_init(&engine.game);
+	} else if (token && strcmp(token, "fen") == 0) {
+		token = strtok(0, " \t");
+		if (!token || !game_load_fen(&engine.game, token)) {
+			say("info string invalid fen %s", token ? token : "");
+			game_init(&engine.game);
+			return;
+		}
+	} else {
+		say("info string expected startpos or fen");
+		return;
+	}
+
+	token = strtok(0, " \t");
+	if (token && strcmp(token, "moves") == 0) {
+		while ((token = strtok(0, " \t"))) {
+			bb_move_t move;
+			if (!game_parse_move(&engine.game, token, &move)) {
+				say("info string invalid move %s", token);
+				return;
+			}
+			perform_turn(&engine.game, &move);
+		}
+	}
+}
+
+static void go(char *args) {
+	stop_search();
+	search_limits_t limits = {0};
+	limits.depth = SEARCH_MAX_DEPTH;
+	limits.threads = engine.threads;
+	limits.multipv = engine.multipv;
+	limits.nn = engine.nn;
+	limits.control = &engine.control;
+	limits.report = report;
+	engine.infinite = false;
+	bool ponder = false;
+
+	bool white = engine.game.current_turn == PIECE_WHITE;
+	for (char *token = strtok(args, " \t"); token; token = strtok(0, " \t")) {
+		if (strcmp(token, "infinite") == 0) {
+			engine.infinite = true;
+			continue;
+		}
+		if (strcmp(token, "ponder") == 0) {
+			ponder = true;
+			continue;
+		}
+		char *value = strtok(0, " \t");
+		if (!value) {
+			say("info string %s needs a value", token);
+			break;
+		}
+		if (strcmp(token, "depth") == 0)
+			limits.depth = atoi(value);
+		else if (strcmp(token, "nodes") == 0)
+			limits.nodes = strtoull(value, 0, 10);
+		else if (strcmp(token, "movetime") == 0)
+			limits.time_limit = atof(value) / 1000;
+		else if (strcmp(token, white ? "wtime" : "btime") == 0)
+			limits.clock = atof(value) / 1000;
+		else if (strcmp(token, white ? "winc" : "binc") == 0)
+			limits.increment = atof(value) / 1000;
+		else if (strcmp(token, "wtime") != 0 && strcmp(token, "btime") != 0 &&
+			strcmp(token, "winc") != 0 && strcmp(token, "binc") != 0)
+			say("info string unknown go parameter %s", token);
+	}
+	if (limits.depth < 1)
+		limits.depth = 1;
+
+	engine.limits = limits;
+	engine.held = false;
+	thread_atomic_set(&engine.control.stop, 0);
+	thread_atomic_set(&engine.control.pondering, ponder);
+	engine.thread = thread_create(search_proc, 0);
+	if (!engine.thread)
+		say("info string could not start the search");
+}
+
+static void set_option(char *args) {
+	char *name = strtok(args, " \t");
+	char *value = strtok(0, "\r\n");
+	if (!name || !value) {
+		say("info string setoption needs a name and a value");
+		return;
+	}
+	if (strcmp(name, "Hash") == 0 && atoi(value) > 0) {
+		tt_t *tt = tt_create(atoi(value));
+		if (tt) {
+			tt_destroy(engine.tt);
+			engine.tt = tt;
+			engine.hash_mb = atoi(value);
+		} else {
+			say("info string could not allocate %s MB", value);
+		}
+	} else if (strcmp(name, "Threads") == 0 && atoi(value) > 0) {
+		engine.threads = atoi(value);
+	} else if (strcmp(name, "MultiPV") == 0 && atoi(value) > 0 && atoi(value) <= SEARCH_MAX_LINES) {
+		engine.multipv = atoi(value);
+	} else if (strcmp(name, "Tablebases") == 0) {
+		if (engine.tb)
+			tb_close(engine.tb);
+		engine.tb = tb_open(value);
+		if (engine.tb && tb_max_pieces(engine.tb) == 0) {
+			tb_close(engine.tb);
+			engine.tb = 0;
+		}
+		say("info string tablebases up to %d pieces", engine.tb ? tb_max_pieces(engine.tb) : 0);
+	} else if (strcmp(name, "Network") == 0) {
+		if (engine.nn)
+			nn_close(engine.nn);
+		engine.nn = nn_open(value);
+		if (engine.nn)
+			say("info string neural evaluation with the %s kernel", nn_kernel_name(nn_kernel(engine.nn)));
+		else
+			say("info string handcrafted evaluation");
+	} else if (strcmp(name, "Search") == 0 && (strcmp(value, "alphabeta") == 0 || strcmp(value, "mcts") == 0)) {
+		engine.mcts = strcmp(value, "mcts") == 0;
+	} else {
+		say("info string unknown option %s", name);
+	}
+}
+
+int main(void) {
+	game_init(&engine.game);
+	engine.hash_mb = DEFAULT_HASH_MB;
+	engine.threads = 1;
+	engine.multipv = 1;
+	engine.tt = tt_create(DEFAULT_HASH_MB);
+	if (!engine.tt) {
+		fprintf(stderr, "ERROR could not allocate the transposition table\n");
+		return 1;
+	}
+
+	char line[MAX_LINE];
+	while (fgets(line, sizeof(line), stdin)) {
+		line[strcspn(line, "\r\n")] = 0;
+		char *args = line + strcspn(line, " \t");
+		if (*args)
+			*args++ = 0;
+
+		if (strcmp(line, "protocol") == 0) {
+			say("id name netcheckers-engine");
+			say("option Hash %d", DEFAULT_HASH_MB);
+			say("option Threads 1");
+			say("option MultiPV 1");
+			say("option Tablebases");
+			say("option Network");
+			say("option Search alphabeta");
+			say("protocolok");
+		} else if (strcmp(line, "isready") == 0) {
+			say("readyok");
+		} else if (strcmp(line, "newgame") == 0) {
+			stop_search();
+			tt_clear(engine.tt);
+		} else if (strcmp(line, "setoption") == 0) {
+			stop_search();
+			set_option(args);
+		} else if (strcmp(line, "position") == 0) {
+			stop_search();
+			set_position(args);
+		} else if (strcmp(line, "go") == 0) {
+			go(args);
+		} else if (strcmp(line, "ponderhit") == 0) {
+			ponderhit();
+		} else if (strcmp(line, "stop") == 0) {
+			stop_search();
+		} else if (strcmp(line, "quit") == 0) {
+			break;
+		} else if (line[0]) {
+			say("info string unknown command %s", line);
+		}
+	}
+
+	stop_search();
+	tt_destroy(engine.tt);
+	if (engine.tb)
+		tb_close(engine.tb);
+	if (engine.nn)
+		nn_close(engine.nn);
+	return 0;
+}
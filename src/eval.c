@@ -0,0 +1,68 @@
+#include "eval.h"
+
+#define MAN_VALUE 100
+#define KING_VALUE 130
+#define TEMPO 3 // per row advanced
+#define BACK_RANK 12
+#define CENTER_MAN 6
+#define CENTER_KING 10
+
+// Black men start at the bottom and move up, white men the other way
+#define LAST_ROW (RULES_BOARD_SIZE - 1)
+#define ROW(square) ((square) / BB_HALF)
+#if RULES_BOARD_SIZE == 10
+	#define CENTER(square) ((square) == 22 || (square) == 23 || (square) == 26 || (square) == 27)
+#else
+	#define CENTER(square) ((square) == 13 || (square) == 14 || (square) == 17 || (square) == 18)
+#endif
+#define BLACK_MAN(square) (MAN_VALUE + TEMPO * (LAST_ROW - ROW(square)) + BACK_RANK * (ROW(square) == LAST_ROW) + CENTER_MAN * CENTER(square))
+#define WHITE_MAN(square) -(MAN_VALUE + TEMPO * ROW(square) + BACK_RANK * (ROW(square) == 0) + CENTER_MAN * CENTER(square))
+#define BLACK_KING(square) (KING_VALUE + CENTER_KING * CENTER(square))
+#define WHITE_KING(square) -BLACK_KING(square)
+
+#define SQUARES_32(entry) \
+	entry(0),  entry(1),  entry(2),  entry(3),  entry(4),  entry(5),  entry(6),  entry(7), \
+	entry(8),  entry(9),  entry(10), entry(11), entry(12), entry(13), entry(14), entry(15), \
+	entry(16), entry(17), entry(18), entry(19), entry(20), entry(21), entry(22), entry(23), \
+	entry(24), entry(25), entry(26), entry(27), entry(28), entry(29), entry(30), entry(31)
+#if RULES_BOARD_SIZE == 10
+#define SQUARES(entry) SQUARES_32(entry), \
+	entry(32), entry(33), entry(34), entry(35), entry(36), entry(37), entry(38), entry(39), \
+	entry(40), entry(41), entry(42), entry(43), entry(44), entry(45), entry(46), entry(47), \
+	entry(48), entry(49)
+#else
+#define SQUARES(entry) SQUARES_32(entry)
+#endif
+
+const int16_t eval_pieces[2][2][BB_SQUARES] = {
+	{ { SQUARES(BLACK_MAN) }, { SQUARES(BLACK_KING) } },
+	{ { SQUARES(WHITE_MAN) }, { SQUARES(WHITE_KING) } },
+};
+
+extern int eval_position(const bitboard_t *bb) {
+	int result = 0;
+	for (int color = 0; color < 2; color++) {
+		for (bb_bits_t rest = bb->color[color]; rest; rest &= rest - 1) {
+			int square = bb_first(rest);
+			result += eval_pieces[color][(bb->kings >> square) & 1][square];
+		}
+	}
+	return result;
+}
+
+// Returns the value to add to the evaluation of `bb` to get the one after the
+// move
+extern int eval_move(const bitboard_t *bb, const bb_move_t *move) {
+	int from = move->path[0];
+	int to = move->path[move->length];
+	piece_color_t color = ((bb->color[PIECE_WHITE] >> from) & 1) ? PIECE_WHITE : PIECE_BLACK;
+	int king = (bb->kings >> from) & 1;
+
+	int result = eval_pieces[color][king | move->crown][to] - eval_pieces[color][king][from];
+	piece_color_t opponent = bb_other(color);
+	for (bb_bits_t rest = move->captures; rest; rest &= rest - 1) {
+		int square = bb_first(rest);
+		result -= eval_pieces[opponent][(bb->kings >> square) & 1][square];
+	}
+	return result;
+}
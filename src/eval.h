@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include "bitboard.h"
+
+/*
+ * Static evaluation in centipawn-like units, always from black's point of
+ * view. Every term belongs to a single piece on a single square, so like the
+ * zobrist hash the evaluation is a sum over the pieces and a move only
+ * changes it by the values of the squares it touches:
+ *
+ *   material     a man is 100, a king 130
+ *   tempo        men gain a little for each row they have advanced
+ *   back rank    men still guarding their own first row, which keeps the
+ *                opponent from crowning there
+ *   center       pieces on the four central squares
+ */
+
+// Value of a piece kind on each square, negative for white pieces
+extern const int16_t eval_pieces[2][2][BB_SQUARES]; // [color][king][square]
+
+int eval_position(const bitboard_t *bb);
+int eval_move(const bitboard_t *bb, const bb_move_t *move);
+
+// An evaluation from the point of view of the given side
+static inline int eval_for(int eval, piece_color_t turn) {
+	return (turn == PIECE_BLACK) ? eval : -eval;
+}
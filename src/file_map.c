@@ -0,0 +1,76 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200112L // mmap, fstat
+#endif
+
+#include <stdio.h>
+
+#include "file_map.h"
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+extern bool file_map_open(file_map_t *map, const char *path) {
+	map->data = 0;
+	map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (map->file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0) {
+		CloseHandle(map->file);
+		return false;
+	}
+	map->mapping = CreateFileMappingA(map->file, 0, PAGE_READONLY, 0, 0, 0);
+	map->data = map->mapping ? MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+	if (!map->data) {
+		fprintf(stderr, "ERROR mapping %s: %lu\n", path, GetLastError());
+		if (map->mapping)
+			CloseHandle(map->mapping);
+		CloseHandle(map->file);
+		return false;
+	}
+	map->size = (size_t)size.QuadPart;
+	return true;
+}
+
+extern void file_map_close(file_map_t *map) {
+	UnmapViewOfFile(map->data);
+	CloseHandle(map->mapping);
+	CloseHandle(map->file);
+	map->data = 0;
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern bool file_map_open(file_map_t *map, const char *path) {
+	map->data = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void *data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		perror(path);
+		return false;
+	}
+	map->data = data;
+	map->size = (size_t)st.st_size;
+	return true;
+}
+
+extern void file_map_close(file_map_t *map) {
+	munmap((void *)map->data, map->size);
+	map->data = 0;
+}
+
+#endif
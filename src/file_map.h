@@ -0,0 +1,17 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A whole file mapped read-only, its pages shared by every process mapping it
+typedef struct {
+	const uint8_t *data; // 0 when nothing is mapped
+	size_t size;
+#ifdef _WIN32
+	void *file, *mapping; // HANDLEs
+#endif
+} file_map_t;
+
+// Fails silently when the file doesn't exist or is empty
+bool file_map_open(file_map_t *map, const char *path);
+void file_map_close(file_map_t *map);
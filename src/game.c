@@ -0,0 +1,573 @@
+/*
+ * The game is based on the standard U.S. rules for checkers:
+ * http://boardgames.about.com/cs/checkersdraughts/ht/play_checkers.htm
+ * The Brazilian and International variants are picked when compiling, see
+ * rules.h.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "game.h"
+#include "zobrist.h"
+#include "eval.h"
+
+static inline cell_pos_t cell_pos(int row, int col) {
+	cell_pos_t result = {row, col};
+	return result;
+}
+
+static bool valid_cell(cell_pos_t pos) {
+	return (pos.row >= 0 && pos.row < RULES_BOARD_SIZE) && (pos.col >= 0 && pos.col < RULES_BOARD_SIZE);
+}
+
+static void place_piece(game_state_t *game, int index, piece_color_t color, bool king, cell_pos_t pos) {
+	piece_t *piece = game->pieces + index;
+	piece->color = color;
+	piece->captured = false;
+	piece->king = king;
+	piece->pos = pos;
+	game->board[pos.row][pos.col] = index;
+
+	bb_bits_t bit = BB_BIT(bb_square(pos));
+	game->bitboard.color[color] |= bit;
+	if (king)
+		game->bitboard.kings |= bit;
+}
+
+// Put the pieces on the board
+extern void game_init(game_state_t *game) {
+	memset(game, 0, sizeof(*game));
+	memset(game->board, -1, sizeof(game->board));
+
+#if 0
+	// Game over testing
+	for (int i = 0; i < 2 * RULES_PIECES; i++) {
+		piece_t *piece = game->pieces + i;
+		piece->color = (i >= RULES_PIECES) ? PIECE_BLACK : PIECE_WHITE;
+		piece->captured = true;
+	}
+	place_piece(game, 0, PIECE_WHITE, true, cell_pos(1, 3));
+	place_piece(game, RULES_PIECES, PIECE_BLACK, true, cell_pos(5, 3));
+#else
+	// whites fill the first squares, blacks the last ones
+	for (int i = 0; i < RULES_PIECES; i++) {
+		place_piece(game, i, PIECE_WHITE, false, bb_cell(i));
+		place_piece(game, RULES_PIECES + i, PIECE_BLACK, false, bb_cell(BB_SQUARES - RULES_PIECES + i));
+	}
+#endif
+
+	game->game_over = false;
+	game->current_turn = PIECE_BLACK;
+	game->hash = zobrist_hash(&game->bitboard, game->current_turn);
+	game->eval = (int16_t)eval_position(&game->bitboard);
+}
+
+/*
+ * Loads a position written as "<turn>:W<squares>:B<squares>", where turn is W
+ * or B and squares is a comma separated list of squares numbered 1 to
+ * BB_SQUARES in the bitboard order (square 1 is the top left cell, where
+ * whites start).
+ * Kings are prefixed with K, e.g. "B:W1,2,K18:B21,K30".
+ */
+extern bool game_load_fen(game_state_t *game, const char *fen) {
+	memset(game, 0, sizeof(*game));
+	memset(game->board, -1, sizeof(game->board));
+	for (int i = 0; i < ARRAY_SIZE(game->pieces); i++)
+		game->pieces[i].captured = true;
+
+	if (fen[0] == 'B')
+		game->current_turn = PIECE_BLACK;
+	else if (fen[0] == 'W')
+		game->current_turn = PIECE_WHITE;
+	else
+		return false;
+
+	int counts[2] = {0};
+	const char *c = fen + 1;
+	while (*c == ':') {
+		c++;
+		piece_color_t color;
+		if (*c == 'W')
+			color = PIECE_WHITE;
+		else if (*c == 'B')
+			color = PIECE_BLACK;
+		else
+			return false;
+		c++;
+		while (*c && *c != ':') {
+			bool king = false;
+			if (*c == 'K') {
+				king = true;
+				c++;
+			}
+			int square = 0;
+			if (*c < '0' || *c > '9')
+				return false;
+			while (*c >= '0' && *c <= '9')
+				square = square * 10 + (*c++ - '0');
+			if (square < 1 || square > BB_SQUARES || counts[color] >= RULES_PIECES)
+				return false;
+			cell_pos_t pos = bb_cell(square - 1);
+			if (game->board[pos.row][pos.col] >= 0)
+				return false;
+			int index = (color == PIECE_WHITE ? 0 : RULES_PIECES) + counts[color]++;
+			place_piece(game, index, color, king, pos);
+			if (*c == ',')
+				c++;
+		}
+	}
+	if (*c)
+		return false;
+
+	game->hash = zobrist_hash(&game->bitboard, game->current_turn);
+	game->eval = (int16_t)eval_position(&game->bitboard);
+
+	if (!update_must_capture(game))
+		game->game_over = true;
+	return true;
+}
+
+extern piece_t *game_piece_at(game_state_t *game, cell_pos_t pos) {
+	piece_t *result = 0;
+	if (valid_cell(pos) && game->board[pos.row][pos.col] >= 0)
+		result = game->pieces + game->board[pos.row][pos.col];
+	return result;
+}
+
+// The grid implementation below walks the board one square at a time. It is
+// kept behind GRID_RULES to compare against the bitboard generator.
+#ifdef GRID_RULES
+#if !RULES_AMERICAN
+	#error "the grid implementation only knows the U.S. rules"
+#endif
+
+static void find_move_at_direction(const game_state_t *game, piece_moves_t *moves, const piece_t *piece, int row_dir, int col_dir) {
+	cell_pos_t cur_pos = piece->pos;
+	cell_pos_t move_pos = cell_pos(cur_pos.row + row_dir, cur_pos.col + col_dir);
+	cell_pos_t cap_pos = cell_pos(move_pos.row + row_dir, move_pos.col + col_dir);
+	if (valid_cell(move_pos)) {
+		int8_t other = game->board[move_pos.row][move_pos.col];
+		if (other >= 0) {
+			if (valid_cell(cap_pos) &&
+				game->pieces[other].color != piece->color &&
+				game->board[cap_pos.row][cap_pos.col] < 0
+			) {
+				move_t move = { cap_pos, other };
+				moves->moves[moves->count++] = move;
+			}
+		} else {
+			move_t move = { move_pos, -1 };
+			moves->moves[moves->count++] = move;
+		}
+	}
+}
+
+// Get the possible moves for the piece, if any capture move is found only the
+// capture moves are returned. This function does not check the case when the
+// player is required to make a capture with a piece other than the piece tested.
+static piece_moves_t find_local_moves(const game_state_t *game, const piece_t *piece) {
+	piece_moves_t result = {0};
+
+	if (piece->color == PIECE_WHITE || piece->king) {
+		find_move_at_direction(game, &result, piece, 1, 1);
+		find_move_at_direction(game, &result, piece, 1, -1);
+	}
+	if (piece->color == PIECE_BLACK || piece->king) {
+		find_move_at_direction(game, &result, piece, -1, 1);
+		find_move_at_direction(game, &result, piece, -1, -1);
+	}
+
+	bool has_capture = false;
+	for (int i = 0; i < result.count; i++) {
+		if (result.moves[i].capture >= 0) {
+			has_capture = true;
+			break;
+		}
+	}
+
+	if (has_capture) {
+		// remove non-capture moves
+		int new_count = 0;
+		for (int i = 0; i < result.count; i++) {
+			if (result.moves[i].capture >= 0) {
+				result.moves[new_count++] = result.moves[i];
+			}
+		}
+		result.count = new_count;
+	}
+
+	return result;
+}
+
+// Fill must_capture with the pieces of the current turn that have a capture,
+// returns false if the current player has no move at all
+extern bool update_must_capture(game_state_t *game) {
+	bool can_move = false;
+	game->must_capture_count = 0;
+	for (int i = 0; i < ARRAY_SIZE(game->pieces); i++) {
+		piece_t *test = game->pieces + i;
+		if (test->color == game->current_turn && !test->captured) {
+			piece_moves_t moves = find_local_moves(game, test);
+			if (moves.count) {
+				can_move = true;
+				if (moves.moves[0].capture >= 0) {
+					game->must_capture[game->must_capture_count++] = i;
+				}
+			}
+		}
+	}
+	return can_move;
+}
+#else
+static piece_moves_t find_local_moves(const game_state_t *game, const piece_t *piece) {
+	piece_moves_t result = {0};
+	bb_hop_t hops[BB_SQUARE_HOPS];
+	int count = bb_square_hops(&game->bitboard, bb_square(piece->pos), game->chain_captures, hops);
+	for (int i = 0; i < count; i++) {
+		move_t move = { bb_cell(hops[i].to), -1 };
+		if (hops[i].capture >= 0) {
+			cell_pos_t cap_pos = bb_cell(hops[i].capture);
+			move.capture = game->board[cap_pos.row][cap_pos.col];
+		}
+		result.moves[result.count++] = move;
+	}
+	return result;
+}
+
+// With RULES_MAXIMUM_CAPTURE only the pieces that can take the most pieces
+extern bool update_must_capture(game_state_t *game) {
+	game->must_capture_count = 0;
+#if RULES_MAXIMUM_CAPTURE
+	bb_bits_t jumpers = bb_longest_jumpers(&game->bitboard, game->current_turn);
+#else
+	bb_bits_t jumpers = bb_jumpers(&game->bitboard, game->current_turn);
+#endif
+	for (bb_bits_t rest = jumpers; rest; rest &= rest - 1) {
+		cell_pos_t pos = bb_cell(bb_first(rest));
+		game->must_capture[game->must_capture_count++] = game->board[pos.row][pos.col];
+	}
+	return jumpers || bb_movers(&game->bitboard, game->current_turn);
+}
+#endif
+
+// This function finds the moves taking in consideration required captures
+extern piece_moves_t find_valid_moves(const game_state_t *game, cell_pos_t pos) {
+	piece_moves_t result = {0};
+	if (!valid_cell(pos) || game->board[pos.row][pos.col] < 0)
+		return result;
+
+	int8_t index = game->board[pos.row][pos.col];
+	bool piece_can_move = true;
+	if (game->must_capture_count) {
+		piece_can_move = false;
+		for (int i = 0; i < game->must_capture_count; i++) {
+			if (game->must_capture[i] == index) {
+				piece_can_move = true;
+				break;
+			}
+		}
+	}
+	if (piece_can_move) {
+		result = find_local_moves(game, game->pieces + index);
+	}
+	return result;
+}
+
+// Moves the piece at `from` to `target` if that is a valid move for the
+// player in turn. The move made is written to `performed` when it isn't null.
+extern move_result_t perform_move(game_state_t *game, cell_pos_t from, cell_pos_t target, move_t *performed) {
+	move_result_t result = MOVE_INVALID;
+
+	piece_t *piece = game_piece_at(game, from);
+	if (!piece || piece->color != game->current_turn || game->game_over)
+		return result;
+
+	piece_moves_t moves = find_valid_moves(game, from);
+	move_t *move = 0;
+	for (int i = 0; i < moves.count; i++) {
+		move_t *test = moves.moves + i;
+		if (test->pos.row == target.row && test->pos.col == target.col) {
+			move = test;
+			break;
+		}
+	}
+
+	if (move) {
+		if (performed)
+			*performed = *move;
+
+		bb_hop_t hop = { (int8_t)bb_square(move->pos), -1 };
+		if (move->capture >= 0)
+			hop.capture = (int8_t)bb_square(game->pieces[move->capture].pos);
+		bb_apply_hop(&game->bitboard, bb_square(piece->pos), hop);
+		game->hash ^= zobrist_pieces[piece->color][piece->king][bb_square(piece->pos)];
+		game->eval -= eval_pieces[piece->color][piece->king][bb_square(piece->pos)];
+
+		game->board[move->pos.row][move->pos.col] = game->board[piece->pos.row][piece->pos.col];
+		game->board[piece->pos.row][piece->pos.col] = -1;
+		piece->pos = move->pos;
+
+		bool far_row = (piece->color == PIECE_BLACK && move->pos.row == 0) ||
+			(piece->color == PIECE_WHITE && move->pos.row == RULES_BOARD_SIZE - 1);
+		if (far_row && (RULES_CROWN_IN_CHAIN || move->capture < 0))
+			piece->king = true;
+		game->hash ^= zobrist_pieces[piece->color][piece->king][hop.to];
+		game->eval += eval_pieces[piece->color][piece->king][hop.to];
+
+		bool end_turn = true;
+		if (move->capture >= 0) {
+			piece_t *captured = game->pieces + move->capture;
+			game->hash ^= zobrist_pieces[captured->color][captured->king][hop.capture];
+			game->eval -= eval_pieces[captured->color][captured->king][hop.capture];
+			if (RULES_CAPTURED_STAY)
+				game->chain_captures |= BB_BIT(hop.capture);
+			else
+				game->board[captured->pos.row][captured->pos.col] = -1;
+			captured->captured = true;
+
+			piece_moves_t moves_after = find_local_moves(game, piece);
+			if (moves_after.count > 0 && moves_after.moves[0].capture >= 0) {
+				end_turn = false;
+			}
+		}
+
+		if (end_turn && !RULES_CROWN_IN_CHAIN && far_row && !piece->king) {
+			// the capture chain ended on the far row
+			piece->king = true;
+			game->bitboard.kings |= BB_BIT(hop.to);
+			game->hash ^= zobrist_pieces[piece->color][0][hop.to] ^ zobrist_pieces[piece->color][1][hop.to];
+			game->eval += eval_pieces[piece->color][1][hop.to] - eval_pieces[piece->color][0][hop.to];
+		}
+		if (end_turn && RULES_CAPTURED_STAY) {
+			for (bb_bits_t rest = game->chain_captures; rest; rest &= rest - 1) {
+				cell_pos_t pos = bb_cell(bb_first(rest));
+				game->board[pos.row][pos.col] = -1;
+			}
+			game->bitboard.color[bb_other(piece->color)] &= ~game->chain_captures;
+			game->bitboard.kings &= ~game->chain_captures;
+			game->chain_captures = 0;
+		}
+
+		if (end_turn) {
+			game->current_turn = bb_other(game->current_turn);
+			game->hash ^= zobrist_white_turn;
+			// the player lose when there is no move available
+			if (!update_must_capture(game))
+				game->game_over = true;
+		} else {
+			// the capture chain must go on with the same piece
+			game->must_capture_count = 1;
+			game->must_capture[0] = game->board[piece->pos.row][piece->pos.col];
+		}
+
+		result = end_turn ? MOVE_END_TURN : MOVE_CONTINUE_TURN;
+	}
+
+	return result;
+}
+
+// Lists every complete move of the player in turn, capture chains included
+extern int find_turn_moves(const game_state_t *game, bb_move_t moves[BB_MAX_MOVES]) {
+	int result = 0;
+	if (!game->game_over)
+		result = bb_generate_moves(&game->bitboard, game->current_turn, moves);
+	return result;
+}
+
+static bool same_path(const bb_move_t *a, const bb_move_t *b) {
+	return a->length == b->length && memcmp(a->path, b->path, a->length + 1) == 0;
+}
+
+#if RULES_MAXIMUM_CAPTURE
+// bb_generate_moves lists a chain taking the same pieces to the same square
+// in one order only. Another order is played hop by hop on a copy to check
+// it, and the squares of the pieces it took are returned in captures.
+static bool valid_chain(const game_state_t *game, const bb_move_t *move, bb_bits_t *captures) {
+	if (move->length < 1 || move->length > BB_MAX_HOPS)
+		return false;
+	game_state_t copy = *game;
+	*captures = 0;
+	for (int i = 1; i <= move->length; i++) {
+		move_t performed;
+		move_result_t res = perform_move(&copy, bb_cell(move->path[i - 1]), bb_cell(move->path[i]), &performed);
+		if (res != ((i == move->length) ? MOVE_END_TURN : MOVE_CONTINUE_TURN) || performed.capture < 0)
+			return false;
+		*captures |= BB_BIT(bb_square(copy.pieces[performed.capture].pos));
+	}
+	return true;
+}
+#endif
+
+// Plays a whole turn in one call. The move only needs its path filled, it is
+// checked against the moves of the player in turn. With RULES_MAXIMUM_CAPTURE
+// a chain taking the listed pieces in another legal order is accepted too.
+extern move_result_t perform_turn(game_state_t *game, const bb_move_t *move) {
+	move_result_t result = MOVE_INVALID;
+
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = find_turn_moves(game, moves);
+	const bb_move_t *valid = 0;
+	for (int i = 0; i < count; i++) {
+		if (same_path(moves + i, move)) {
+			valid = moves + i;
+			break;
+		}
+	}
+#if RULES_MAXIMUM_CAPTURE
+	bb_bits_t captures;
+	if (!valid && valid_chain(game, move, &captures)) {
+		for (int i = 0; i < count; i++) {
+			const bb_move_t *test = moves + i;
+			if (test->captures == captures && test->path[0] == move->path[0] && test->path[test->length] == move->path[move->length]) {
+				valid = test;
+				break;
+			}
+		}
+	}
+#endif
+
+	if (valid) {
+		undo_t undo;
+		make_move(game, valid, &undo);
+		result = MOVE_END_TURN;
+	}
+
+	return result;
+}
+
+// Plays a whole move from find_turn_moves without checking it, and saves in
+// undo what unmake_move needs to take it back
+extern void make_move(game_state_t *game, const bb_move_t *move, undo_t *undo) {
+	cell_pos_t from = bb_cell(move->path[0]);
+	cell_pos_t to = bb_cell(move->path[move->length]);
+	int8_t index = game->board[from.row][from.col];
+	piece_t *piece = game->pieces + index;
+
+	undo->from = (int8_t)move->path[0];
+	undo->to = (int8_t)move->path[move->length];
+	undo->crowned = move->crown;
+	undo->game_over = game->game_over;
+	undo->captures = move->captures;
+	undo->must_capture_count = game->must_capture_count;
+	memcpy(undo->must_capture, game->must_capture, sizeof(undo->must_capture));
+	undo->hash = game->hash;
+	undo->eval = game->eval;
+
+	int count = 0;
+	for (bb_bits_t rest = move->captures; rest; rest &= rest - 1) {
+		cell_pos_t pos = bb_cell(bb_first(rest));
+		int8_t captured = game->board[pos.row][pos.col];
+		undo->captured[count++] = captured;
+		game->pieces[captured].captured = true;
+		game->board[pos.row][pos.col] = -1;
+	}
+	// a king's chain can end on the square it started from
+	game->board[from.row][from.col] = -1;
+	game->board[to.row][to.col] = index;
+	piece->pos = to;
+	if (move->crown)
+		piece->king = true;
+	game->hash ^= zobrist_move(&game->bitboard, move);
+	game->eval += (int16_t)eval_move(&game->bitboard, move);
+	bb_apply_move(&game->bitboard, move);
+
+	game->current_turn = bb_other(game->current_turn);
+	if (!update_must_capture(game))
+		game->game_over = true;
+}
+
+extern void unmake_move(game_state_t *game, const undo_t *undo) {
+	cell_pos_t from = bb_cell(undo->from);
+	cell_pos_t to = bb_cell(undo->to);
+	int8_t index = game->board[to.row][to.col];
+	piece_t *piece = game->pieces + index;
+	bb_bits_t from_bit = BB_BIT(undo->from);
+	bb_bits_t to_bit = BB_BIT(undo->to);
+
+	game->current_turn = bb_other(game->current_turn);
+	game->bitboard.color[piece->color] = (game->bitboard.color[piece->color] & ~to_bit) | from_bit;
+	game->bitboard.kings &= ~to_bit;
+	if (undo->crowned)
+		piece->king = false;
+	if (piece->king)
+		game->bitboard.kings |= from_bit;
+	game->board[to.row][to.col] = -1;
+	game->board[from.row][from.col] = index;
+	piece->pos = from;
+
+	int count = 0;
+	for (bb_bits_t rest = undo->captures; rest; rest &= rest - 1) {
+		int square = bb_first(rest);
+		cell_pos_t pos = bb_cell(square);
+		piece_t *captured = game->pieces + undo->captured[count];
+		captured->captured = false;
+		game->board[pos.row][pos.col] = undo->captured[count++];
+		game->bitboard.color[captured->color] |= BB_BIT(square);
+		if (captured->king)
+			game->bitboard.kings |= BB_BIT(square);
+	}
+
+	game->game_over = undo->game_over;
+	game->must_capture_count = undo->must_capture_count;
+	memcpy(game->must_capture, undo->must_capture, sizeof(game->must_capture));
+	game->hash = undo->hash;
+	game->eval = undo->eval;
+}
+
+/*
+ * Reads a move of the player in turn written as its squares, numbered as in
+ * game_load_fen, joined by '-' for a step or 'x' for captures: "22-18",
+ * "15x22" or "15x22x31". A capture chain may be written with only its ends,
+ * as long as no other chain has the same ones.
+ */
+extern bool game_parse_move(const game_state_t *game, const char *text, bb_move_t *move) {
+	int squares[BB_MAX_HOPS + 1];
+	int count = 0;
+	const char *c = text;
+	for (;;) {
+		if (*c < '0' || *c > '9' || count == ARRAY_SIZE(squares))
+			return false;
+		int square = 0;
+		while (*c >= '0' && *c <= '9')
+			square = square * 10 + (*c++ - '0');
+		if (square < 1 || square > BB_SQUARES)
+			return false;
+		squares[count++] = square - 1;
+		if (*c != '-' && *c != 'x')
+			break;
+		c++;
+	}
+	if (*c || count < 2)
+		return false;
+
+	bb_move_t moves[BB_MAX_MOVES];
+	int move_count = find_turn_moves(game, moves);
+	int found = 0;
+	for (int i = 0; i < move_count; i++) {
+		const bb_move_t *m = moves + i;
+		if (m->path[0] != squares[0] || m->path[m->length] != squares[count - 1])
+			continue;
+		if (count > 2) {
+			if (m->length != count - 1)
+				continue;
+			bool same = true;
+			for (int j = 1; j < count - 1; j++)
+				same = same && m->path[j] == squares[j];
+			if (!same)
+				continue;
+		}
+		*move = *m;
+		found++;
+	}
+	return found == 1;
+}
+
+// Writes a move the way game_parse_move reads it, with every square of a
+// capture chain
+extern void game_format_move(const bb_move_t *move, char text[GAME_MOVE_TEXT_SIZE]) {
+	int length = 0;
+	for (int i = 0; i <= move->length; i++) {
+		const char *separator = (i == 0) ? "" : move->captures ? "x" : "-";
+		length += snprintf(text + length, GAME_MOVE_TEXT_SIZE - length, "%s%d", separator, move->path[i] + 1);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "common.h"
+#include "bitboard.h"
+
+typedef struct {
+	piece_color_t color;
+	bool captured;
+	bool king;
+	cell_pos_t pos;
+} piece_t;
+
+typedef struct {
+	cell_pos_t pos;
+	int8_t capture; // index in game_state_t.pieces, -1 when the move isn't a capture
+} move_t;
+
+typedef struct {
+	move_t moves[BB_SQUARE_HOPS];
+	int count;
+} piece_moves_t;
+
+// The whole state of a match. It holds no pointers, so it can be copied by
+// value and many games can live side by side in a flat array.
+typedef struct {
+	piece_t pieces[2 * RULES_PIECES];
+	int8_t board[RULES_BOARD_SIZE][RULES_BOARD_SIZE]; // index in pieces, -1 for empty cells
+	bitboard_t bitboard; // mirrors board, used by the move generator
+	bb_bits_t chain_captures; // taken so far by perform_move in a capture chain, still on the board with RULES_CAPTURED_STAY
+	piece_color_t current_turn;
+	uint64_t hash; // zobrist key of the pieces and the player in turn
+	int16_t eval; // eval_position of bitboard, kept up to date move by move
+	bool game_over;
+	int8_t must_capture_count;
+	int8_t must_capture[RULES_PIECES]; // indexes in pieces
+} game_state_t;
+
+typedef enum { MOVE_INVALID, MOVE_CONTINUE_TURN, MOVE_END_TURN } move_result_t;
+
+#define GAME_MOVE_TEXT_SIZE (3 * (BB_MAX_HOPS + 1) + 1) // "1x10x19..." with all the squares of the longest chain
+
+// What make_move needs to put back that can't be told from the state after
+// the move
+typedef struct {
+	int8_t from, to; // squares
+	bool crowned;
+	bool game_over;
+	bb_bits_t captures; // squares of the captured pieces
+	int8_t captured[BB_MAX_HOPS]; // their indexes in pieces, in square order
+	int8_t must_capture_count;
+	int8_t must_capture[RULES_PIECES];
+	uint64_t hash;
+	int16_t eval;
+} undo_t;
+
+void game_init(game_state_t *game);
+bool game_load_fen(game_state_t *game, const char *fen);
+piece_t *game_piece_at(game_state_t *game, cell_pos_t pos);
+
+bool update_must_capture(game_state_t *game);
+piece_moves_t find_valid_moves(const game_state_t *game, cell_pos_t pos);
+move_result_t perform_move(game_state_t *game, cell_pos_t from, cell_pos_t target, move_t *performed);
+
+int find_turn_moves(const game_state_t *game, bb_move_t moves[BB_MAX_MOVES]);
+move_result_t perform_turn(game_state_t *game, const bb_move_t *move);
+void make_move(game_state_t *game, const bb_move_t *move, undo_t *undo);
+void unmake_move(game_state_t *game, const undo_t *undo);
+bool game_parse_move(const game_state_t *game, const char *text, bb_move_t *move);
+void game_format_move(const bb_move_t *move, char text[GAME_MOVE_TEXT_SIZE]);
@@ -0,0 +1,166 @@
+/*
+ * Times the move generation of a single position against the batch kernels,
+ * over a fixed set of positions taken from seeded random games:
+ *
+ *   find_valid_moves  - every piece of the side to move, one position at a
+ *                       time, on the grid when built with -DGRID_RULES
+ *   bb_batch_masks    - movers and jumpers of whole batches of positions,
+ *                       with each kernel the CPU supports and growing batch
+ *                       sizes
+ *
+ * Built twice, like perft, to compare the step and jump tables of the
+ * bitboard against the grid walk. The masks of every kernel are checked
+ * against the moves find_valid_moves returns. Output is one tab separated
+ * line per generator and batch size.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "bitboard_batch.h"
+#include "timer.h"
+
+#ifdef GRID_RULES
+	#define HOPS_GENERATOR "find_valid_moves(grid)"
+#else
+	#define HOPS_GENERATOR "find_valid_moves(tables)"
+#endif
+
+#define DEFAULT_POSITIONS 10000
+#define DEFAULT_ROUNDS 100
+
+static uint64_t xorshift64(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+// Plays random turns from the initial position, starting over when the game
+// ends, and keeps every position reached
+static void random_positions(game_state_t *positions, int count) {
+	uint64_t seed = 0x9E3779B97F4A7C15ull;
+	game_state_t game;
+	game_init(&game);
+	for (int i = 0; i < count; i++) {
+		bb_move_t moves[BB_MAX_MOVES];
+		int move_count = game.game_over ? 0 : find_turn_moves(&game, moves);
+		if (move_count == 0) {
+			game_init(&game);
+			move_count = find_turn_moves(&game, moves);
+		}
+		perform_turn(&game, moves + xorshift64(&seed) % move_count);
+		positions[i] = game;
+	}
+}
+
+// The masks of a position from its pieces' moves: with a capture to make
+// only the jumpers have moves, so the movers are left out
+static bb_masks_t hops_masks(const game_state_t *game) {
+	bb_masks_t result = {0};
+	for (int i = 0; i < ARRAY_SIZE(game->pieces); i++) {
+		const piece_t *piece = game->pieces + i;
+		if (piece->captured || piece->color != game->current_turn)
+			continue;
+		piece_moves_t moves = find_valid_moves(game, piece->pos);
+		if (moves.count) {
+			uint32_t bit = 1u << bb_square(piece->pos);
+			if (moves.moves[0].capture >= 0)
+				result.jumpers |= bit;
+			else
+				result.movers |= bit;
+		}
+	}
+	return result;
+}
+
+static bool same_moves(bb_masks_t batch, bb_masks_t hops) {
+	if (batch.jumpers)
+		return batch.jumpers == hops.jumpers && hops.movers == 0;
+	return batch.movers == hops.movers && hops.jumpers == 0;
+}
+
+static void report(const char *generator, int batch, uint64_t positions, double seconds) {
+	double pps = (seconds > 0) ? positions / seconds : 0;
+	printf("%s\t%d\t%llu\t%.6f\t%.0f\n", generator, batch, (unsigned long long)positions, seconds, pps);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	if (argc > 3 || (argc > 1 && atoi(argv[1]) < 1) || (argc > 2 && atoi(argv[2]) < 1)) {
+		fprintf(stderr,
+			"Usage:\n"
+			"    %s [POSITIONS [ROUNDS]]\n"
+			"\n"
+			"POSITIONS defaults to %d and ROUNDS to %d.\n",
+			argv[0], DEFAULT_POSITIONS, DEFAULT_ROUNDS
+		);
+		return 1;
+	}
+	int count = (argc > 1) ? atoi(argv[1]) : DEFAULT_POSITIONS;
+	int rounds = (argc > 2) ? atoi(argv[2]) : DEFAULT_ROUNDS;
+
+	game_state_t *games = malloc(count * sizeof(game_state_t));
+	bitboard_t *bbs = malloc(count * sizeof(bitboard_t));
+	piece_color_t *turns = malloc(count * sizeof(piece_color_t));
+	bb_masks_t *expected = malloc(count * sizeof(bb_masks_t));
+	bb_masks_t *masks = malloc(count * sizeof(bb_masks_t));
+	if (!games || !bbs || !turns || !expected || !masks)
+		return 1;
+	random_positions(games, count);
+	for (int i = 0; i < count; i++) {
+		bbs[i] = games[i].bitboard;
+		turns[i] = games[i].current_turn;
+	}
+
+	printf("generator\tbatch\tpositions\tseconds\tpositions_per_sec\n");
+
+	// The sum keeps the calls from being optimized away
+	uint32_t sum = 0;
+	double start = timer_seconds();
+	for (int round = 0; round < rounds; round++) {
+		for (int i = 0; i < count; i++) {
+			expected[i] = hops_masks(games + i);
+			sum += expected[i].movers ^ expected[i].jumpers;
+		}
+	}
+	report(HOPS_GENERATOR, 1, (uint64_t)count * rounds, timer_seconds() - start);
+
+	int return_status = 0;
+	for (int kernel = BB_KERNEL_SCALAR; kernel <= bb_batch_kernel(); kernel++) {
+		char generator[64];
+		snprintf(generator, sizeof(generator), "bb_batch_masks(%s)", bb_kernel_name(kernel));
+		for (int batch = 8; ; batch = (batch * 8 > count && batch < count) ? count : batch * 8) {
+			int size = (batch < count) ? batch : count;
+			start = timer_seconds();
+			for (int round = 0; round < rounds; round++) {
+				for (int i = 0; i < count; i += size) {
+					int n = (count - i < size) ? count - i : size;
+					bb_batch_masks_with(kernel, bbs + i, turns + i, n, masks + i);
+				}
+				sum += masks[round % count].movers;
+			}
+			report(generator, size, (uint64_t)count * rounds, timer_seconds() - start);
+
+			for (int i = 0; i < count; i++) {
+				if (!games[i].game_over && !same_moves(masks[i], expected[i])) {
+					fprintf(stderr, "ERROR %s masks differ from find_valid_moves at position %d\n", generator, i);
+					return_status = 1;
+					break;
+				}
+			}
+			if (size == count)
+				break;
+		}
+	}
+
+	fprintf(stderr, "checksum %08x\n", sum);
+	free(games);
+	free(bbs);
+	free(turns);
+	free(expected);
+	free(masks);
+	return return_status;
+}
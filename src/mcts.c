@@ -0,0 +1,298 @@
+/*
+ * Parallel Monte Carlo tree search over whole turns.
+ *
+ * Threads share the tree without locks. Each node is expanded by the one
+ * thread that swaps its children from 0 to EXPANDING, the others reaching it
+ * meanwhile play out from the node itself. The children are taken from the
+ * arena with an atomic add and published by storing their index last.
+ *
+ * On the way down every node on the path gets VIRTUAL_LOSS visits that score
+ * nothing, so the threads spread over different lines instead of all
+ * following the best one. The backup gives back all of them but one and adds
+ * the points of the playout.
+ *
+ * Playouts pick uniformly among the moves of the bitboard generator. One
+ * that lasts ROLLOUT_MAX_PLIES is decided by the static evaluation.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eval.h"
+#include "mcts.h"
+#include "thread.h"
+#include "timer.h"
+
+#define MAX_THREADS 256
+
+#define EXPLORATION 1.0f // UCT constant, on win rates from 0 to 1
+#define VIRTUAL_LOSS 3
+#define MAX_TREE_DEPTH 256
+#define ROLLOUT_MAX_PLIES 200
+#define ADJUDICATE_MARGIN 80 // evaluation a side needs to win an unfinished playout
+#define CHECK_PLAYOUTS 16 // between checks of the limits by the main thread
+
+// Values of node_t.children besides an index in the arena
+#define NOT_EXPANDED 0 // the root is at index 0, so it is never a child
+#define EXPANDING (-1)
+#define TERMINAL (-2) // the side to move has no move
+
+typedef struct {
+	bb_move_t move; // from the parent
+	volatile int visits; // with the virtual losses of the playouts under way
+	volatile int points; // of the side that played move: 2 for a win, 1 for a draw
+	volatile int children; // index of the first one, or one of the values above
+	int child_count; // written before children is published
+} node_t;
+
+typedef struct _mcts_thread mcts_thread_t;
+
+typedef struct {
+	bitboard_t bb;
+	piece_color_t turn;
+	mcts_limits_t limits;
+	node_t *nodes; // the arena, the root first
+	int capacity;
+	volatile int used;
+	volatile int full;
+	double start_time; // reset when pondering ends
+	bool pondering; // only read and written by the main thread
+	volatile int stop;
+	mcts_thread_t *threads;
+	int thread_count;
+} mcts_shared_t;
+
+struct _mcts_thread {
+	mcts_shared_t *shared;
+	int id;
+	uint64_t rng;
+	uint64_t playouts;
+};
+
+static uint64_t xorshift64(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+static bool must_stop(mcts_thread_t *thread) {
+	mcts_shared_t *shared = thread->shared;
+	search_control_t *control = shared->limits.control;
+	if (thread->id == 0 && thread->playouts % CHECK_PLAYOUTS == 0) {
+		if (control && thread_atomic_get(&control->stop))
+			thread_atomic_set(&shared->stop, 1);
+		if (shared->pondering && !thread_atomic_get(&control->pondering)) {
+			shared->pondering = false;
+			shared->start_time = timer_seconds();
+		}
+		double time_limit = shared->limits.time_limit;
+		if (!shared->pondering && time_limit > 0 && timer_seconds() - shared->start_time >= time_limit)
+			thread_atomic_set(&shared->stop, 1);
+		if (shared->limits.playouts > 0) {
+			// read while the other threads count, it only needs to be about right
+			uint64_t playouts = 0;
+			for (int i = 0; i < shared->thread_count; i++)
+				playouts += shared->threads[i].playouts;
+			if (playouts >= shared->limits.playouts)
+				thread_atomic_set(&shared->stop, 1);
+		}
+	}
+	return thread_atomic_get(&shared->stop) != 0;
+}
+
+// Gives node its children and returns the new value of its children field,
+// unless another thread got to it first or the arena is full
+static int expand(mcts_shared_t *shared, node_t *node, const bitboard_t *bb, piece_color_t turn) {
+	if (thread_atomic_get(&shared->full) || !thread_atomic_compare_exchange(&node->children, NOT_EXPANDED, EXPANDING))
+		return thread_atomic_get(&node->children);
+
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = bb_generate_moves(bb, turn, moves);
+	if (count == 0) {
+		thread_atomic_set(&node->children, TERMINAL);
+		return TERMINAL;
+	}
+	int first = thread_atomic_add(&shared->used, count);
+	if (first > shared->capacity - count) {
+		thread_atomic_set(&shared->full, 1);
+		thread_atomic_set(&node->children, NOT_EXPANDED);
+		return NOT_EXPANDED;
+	}
+	for (int i = 0; i < count; i++) {
+		node_t *child = shared->nodes + first + i;
+		child->move = moves[i];
+		child->visits = 0;
+		child->points = 0;
+		child->children = NOT_EXPANDED;
+		child->child_count = 0;
+	}
+	node->child_count = count;
+	thread_atomic_set(&node->children, first);
+	return first;
+}
+
+// The child with the highest upper confidence bound, the first one never
+// visited if there is any
+static int select_child(const mcts_shared_t *shared, node_t *node, int first) {
+	float log_visits = logf((float)thread_atomic_get(&node->visits) + 1);
+	int best = first;
+	float best_value = -1;
+	for (int i = first; i < first + node->child_count; i++) {
+		node_t *child = shared->nodes + i;
+		int visits = thread_atomic_get(&child->visits);
+		if (visits == 0)
+			return i;
+		float value = thread_atomic_get(&child->points) / (2.0f * visits) + EXPLORATION * sqrtf(log_visits / visits);
+		if (value > best_value) {
+			best_value = value;
+			best = i;
+		}
+	}
+	return best;
+}
+
+// Plays random moves to the end of the game, returns the winner or -1 for a
+// draw
+static int rollout(mcts_thread_t *thread, bitboard_t bb, piece_color_t turn) {
+	for (int ply = 0; ply < ROLLOUT_MAX_PLIES; ply++) {
+		bb_move_t moves[BB_MAX_MOVES];
+		int count = bb_generate_moves(&bb, turn, moves);
+		if (count == 0)
+			return bb_other(turn);
+		bb_apply_move(&bb, &moves[xorshift64(&thread->rng) % count]);
+		turn = bb_other(turn);
+	}
+	int eval = eval_position(&bb);
+	if (eval > ADJUDICATE_MARGIN)
+		return PIECE_BLACK;
+	if (eval < -ADJUDICATE_MARGIN)
+		return PIECE_WHITE;
+	return -1;
+}
+
+static void playout(mcts_thread_t *thread) {
+	mcts_shared_t *shared = thread->shared;
+	bitboard_t bb = shared->bb;
+	piece_color_t turn = shared->turn;
+	int path[MAX_TREE_DEPTH + 1];
+	piece_color_t movers[MAX_TREE_DEPTH + 1]; // of the move into each node of the path
+	int depth = 0;
+	path[0] = 0;
+	movers[0] = bb_other(turn);
+	thread_atomic_add(&shared->nodes[0].visits, VIRTUAL_LOSS);
+
+	while (depth < MAX_TREE_DEPTH) {
+		node_t *node = shared->nodes + path[depth];
+		int children = thread_atomic_get(&node->children);
+		bool leaf = children == NOT_EXPANDED;
+		if (leaf)
+			children = expand(shared, node, &bb, turn);
+		if (children <= 0) // terminal, taken by another thread or the arena is full
+			break;
+		int index = select_child(shared, node, children);
+		node_t *child = shared->nodes + index;
+		thread_atomic_add(&child->visits, VIRTUAL_LOSS);
+		bb_apply_move(&bb, &child->move);
+		path[++depth] = index;
+		movers[depth] = turn;
+		turn = bb_other(turn);
+		if (leaf) // one new node per playout
+			break;
+	}
+
+	int winner = rollout(thread, bb, turn);
+	for (int i = 0; i <= depth; i++) {
+		node_t *node = shared->nodes + path[i];
+		int points = (winner < 0) ? 1 : (winner == (int)movers[i]) ? 2 : 0;
+		if (points)
+			thread_atomic_add(&node->points, points);
+		thread_atomic_add(&node->visits, 1 - VIRTUAL_LOSS);
+	}
+	thread->playouts++;
+}
+
+static int mcts_thread_proc(void *data) {
+	mcts_thread_t *thread = data;
+	while (!must_stop(thread))
+		playout(thread);
+	return 0;
+}
+
+extern mcts_result_t mcts_search(const bitboard_t *bb, piece_color_t turn, const mcts_limits_t *limits) {
+	mcts_result_t result = {0};
+	bb_move_t moves[BB_MAX_MOVES];
+	if (bb_generate_moves(bb, turn, moves) == 0)
+		return result;
+
+	mcts_shared_t shared = {0};
+	shared.bb = *bb;
+	shared.turn = turn;
+	shared.limits = *limits;
+	size_t capacity = (limits->megabytes << 20) / sizeof(node_t);
+	if (capacity > 0x40000000) // so used can't overflow with every thread adding past the end
+		capacity = 0x40000000;
+	if (capacity < BB_MAX_MOVES + 1)
+		capacity = BB_MAX_MOVES + 1;
+	shared.capacity = (int)capacity;
+	shared.nodes = malloc(capacity * sizeof(node_t));
+	int thread_count = limits->threads;
+	if (thread_count < 1)
+		thread_count = 1;
+	else if (thread_count > MAX_THREADS)
+		thread_count = MAX_THREADS;
+	mcts_thread_t *threads = calloc(thread_count, sizeof(mcts_thread_t));
+	if (!shared.nodes || !threads) {
+		perror("ERROR malloc");
+		free(shared.nodes);
+		free(threads);
+		return result;
+	}
+	memset(shared.nodes, 0, sizeof(node_t));
+	shared.used = 1;
+	shared.start_time = timer_seconds();
+	shared.pondering = limits->control && thread_atomic_get(&limits->control->pondering);
+	shared.threads = threads;
+	shared.thread_count = thread_count;
+
+	thread_t *handles[MAX_THREADS] = {0};
+	for (int i = 0; i < thread_count; i++) {
+		threads[i].shared = &shared;
+		threads[i].id = i;
+		threads[i].rng = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+	}
+	for (int i = 1; i < thread_count; i++)
+		handles[i] = thread_create(mcts_thread_proc, threads + i);
+
+	mcts_thread_proc(threads);
+
+	for (int i = 1; i < thread_count; i++) {
+		if (handles[i])
+			thread_join(handles[i]);
+	}
+
+	result.found = true;
+	result.best_move = moves[0];
+	const node_t *root = shared.nodes;
+	if (root->children > 0) {
+		int best_visits = -1;
+		for (int i = root->children; i < root->children + root->child_count; i++) {
+			const node_t *child = shared.nodes + i;
+			if (child->visits > best_visits) {
+				best_visits = child->visits;
+				result.best_move = child->move;
+				result.win_rate = best_visits ? child->points / (2.0 * best_visits) : 0;
+			}
+		}
+	}
+	for (int i = 0; i < thread_count; i++)
+		result.playouts += threads[i].playouts;
+	result.nodes = (shared.used < shared.capacity) ? shared.used : shared.capacity;
+	result.arena_full = shared.full != 0;
+	result.seconds = timer_seconds() - shared.start_time;
+	free(threads);
+	free(shared.nodes);
+	return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bitboard.h"
+#include "search.h"
+
+/*
+ * Monte Carlo tree search, an alternative to the alpha-beta of search.h. All
+ * the threads grow one tree together: they walk down it by UCT, expand the
+ * leaf they reach and score it with a random game played to the end by the
+ * bitboard move generator. Nodes come from an arena allocated once per
+ * search, when it is full the tree stops growing and the playouts go on from
+ * its leaves.
+ */
+
+typedef struct {
+	double time_limit; // seconds, 0 for no limit
+	uint64_t playouts; // about, for all the threads together, 0 for no limit
+	int threads; // helper threads plus the calling one
+	size_t megabytes; // of the node arena
+	search_control_t *control; // 0 when nothing but the limits ends the search
+} mcts_limits_t;
+
+typedef struct {
+	bool found; // false if the side to move has no move
+	bb_move_t best_move; // the root move visited the most
+	double win_rate; // of best_move for the side to move, a draw counts half
+	uint64_t playouts;
+	uint64_t nodes; // in the tree
+	bool arena_full; // the tree stopped growing before the end
+	double seconds;
+} mcts_result_t;
+
+mcts_result_t mcts_search(const bitboard_t *bb, piece_color_t turn, const mcts_limits_t *limits);
@@ -0,0 +1,191 @@
+/*
+ * Runs the Monte Carlo tree search of mcts.h on a set of positions for a
+ * fixed time with 1 up to N threads and reports playouts/sec and tree
+ * nodes/sec. Output is one tab separated line per thread count.
+ *
+ * With -match it plays the tree search against the alpha-beta search, both
+ * with the same threads and seconds for each move, so they get the same
+ * CPU. Each opening of OPENING_PLIES random moves is played twice with the
+ * colors swapped. A game is a draw after MAX_GAME_PLIES or on the third
+ * repetition of a position. Output is one tab separated line with the
+ * results from the point of view of the tree search, progress goes to
+ * stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "mcts.h"
+#include "search.h"
+
+#define TT_MEGABYTES 64
+#define ARENA_MEGABYTES 256
+#define OPENING_PLIES 6
+#define MAX_GAME_PLIES 300
+
+static const char *default_positions[] = {
+	"B:W1,2,3,4,5,6,7,8,9,10,11,12:B21,22,23,24,25,26,27,28,29,30,31,32",
+	"B:W1,2,3,4,6,7,8,9,10,12,20:B18,23,24,26,27,28,29,30,31,32",
+	"B:W3,4,5,6,7,8,9,10,12,15:B16,18,19,23,24,28,29,30,31,32",
+	"B:W4,5,6,7,8,9,10,12,15:B16,18,19,22,23,24,28,31,32",
+	"B:W4,7,8,9,10,11,12,15,17:B16,18,19,20,22,23,24,27,28",
+	"B:W8,9,11,17,18:B6,19,23,24,27,28",
+};
+
+typedef struct {
+	double seconds; // per move
+	int threads;
+	tt_t *tt;
+	uint64_t mcts_playouts, mcts_moves;
+	uint64_t alphabeta_nodes, alphabeta_moves;
+} match_t;
+
+static uint64_t xorshift64(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+// Times the position of the last ply was reached before with the same side
+// to move
+static int repetitions(const uint64_t *hashes, int ply) {
+	int result = 0;
+	for (int i = ply - 2; i >= 0; i -= 2)
+		result += hashes[i] == hashes[ply];
+	return result;
+}
+
+// Returns the winner, or -1 for a draw
+static int play_game(match_t *match, int opening, piece_color_t mcts_color) {
+	mcts_limits_t mcts_limits = { match->seconds, 0, match->threads, ARENA_MEGABYTES };
+	search_limits_t limits = {0};
+	limits.depth = SEARCH_MAX_DEPTH;
+	limits.time_limit = match->seconds;
+	limits.threads = match->threads;
+
+	uint64_t seed = 0x9E3779B97F4A7C15ull * (uint64_t)(opening + 1);
+	uint64_t hashes[MAX_GAME_PLIES + 1];
+	game_state_t game;
+	game_init(&game);
+	tt_clear(match->tt);
+	hashes[0] = game.hash;
+	for (int ply = 0; ; ply++) {
+		piece_color_t turn = game.current_turn;
+		bb_move_t moves[BB_MAX_MOVES];
+		int move_count = find_turn_moves(&game, moves);
+		if (move_count == 0)
+			return bb_other(turn);
+		if (ply == MAX_GAME_PLIES || repetitions(hashes, ply) >= 2)
+			return -1;
+
+		bb_move_t move;
+		if (ply < OPENING_PLIES) {
+			move = moves[xorshift64(&seed) % move_count];
+		} else if (turn == mcts_color) {
+			mcts_result_t result = mcts_search(&game.bitboard, turn, &mcts_limits);
+			move = result.best_move;
+			match->mcts_playouts += result.playouts;
+			match->mcts_moves++;
+		} else {
+			search_result_t result = search(&game.bitboard, turn, &limits, match->tt, 0);
+			move = result.best_move;
+			match->alphabeta_nodes += result.nodes;
+			match->alphabeta_moves++;
+		}
+		undo_t undo;
+		make_move(&game, &move, &undo);
+		hashes[ply + 1] = game.hash;
+	}
+}
+
+static void run_match(int games, double seconds, int threads) {
+	match_t match = { seconds, threads };
+	match.tt = tt_create(TT_MEGABYTES);
+	if (!match.tt)
+		return;
+	int wins = 0, losses = 0, draws = 0;
+	for (int i = 0; i < games; i++) {
+		piece_color_t mcts_color = (i % 2 == 0) ? PIECE_BLACK : PIECE_WHITE;
+		int winner = play_game(&match, i / 2, mcts_color);
+		if (winner < 0)
+			draws++;
+		else if (winner == (int)mcts_color)
+			wins++;
+		else
+			losses++;
+		fprintf(stderr, "game %d: %d wins, %d losses, %d draws\n", i + 1, wins, losses, draws);
+	}
+	printf("games\tseconds\tthreads\tmcts_wins\tmcts_losses\tdraws\tmcts_score\tplayouts_per_move\talphabeta_nodes_per_move\n");
+	printf("%d\t%.3f\t%d\t%d\t%d\t%d\t%.3f\t%.0f\t%.0f\n", games, seconds, threads, wins, losses, draws,
+		(wins + draws * 0.5) / games,
+		match.mcts_moves ? (double)match.mcts_playouts / match.mcts_moves : 0,
+		match.alphabeta_moves ? (double)match.alphabeta_nodes / match.alphabeta_moves : 0);
+	tt_destroy(match.tt);
+}
+
+int main(int argc, char **argv) {
+	const char *program = argv[0];
+	bool match = argc > 1 && strcmp(argv[1], "-match") == 0;
+	if (match ? (argc != 5 || atoi(argv[2]) < 1 || atof(argv[3]) <= 0 || atoi(argv[4]) < 1)
+		: (argc < 3 || atof(argv[1]) <= 0 || atoi(argv[2]) < 1)) {
+		fprintf(stderr,
+			"Usage:\n"
+			"    %s SECONDS MAX_THREADS [FEN...]\n"
+			"    %s -match GAMES SECONDS THREADS\n"
+			"\n"
+			"Thread counts are the powers of two up to MAX_THREADS, and MAX_THREADS.\n"
+			"Without FENs a fixed set of opening and middle game positions is used.\n"
+			"SECONDS are spent on each position, or on each move of a match.\n",
+			program, program
+		);
+		return 1;
+	}
+
+	if (match) {
+		run_match(atoi(argv[2]), atof(argv[3]), atoi(argv[4]));
+		return 0;
+	}
+
+	double seconds = atof(argv[1]);
+	int max_threads = atoi(argv[2]);
+	const char **fens = default_positions;
+	int fen_count = ARRAY_SIZE(default_positions);
+	if (argc > 3) {
+		fens = (const char **)argv + 3;
+		fen_count = argc - 3;
+	}
+	game_state_t *games = malloc(fen_count * sizeof(game_state_t));
+	if (!games)
+		return 1;
+	for (int i = 0; i < fen_count; i++) {
+		if (!game_load_fen(games + i, fens[i])) {
+			fprintf(stderr, "ERROR invalid FEN: %s\n", fens[i]);
+			return 1;
+		}
+	}
+
+	printf("threads\tplayouts\tnodes\tseconds\tplayouts_per_sec\tnodes_per_sec\tplayouts_per_sec_per_thread\tarena_full\n");
+	for (int threads = 1; threads <= max_threads; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2) {
+		mcts_limits_t limits = { seconds, 0, threads, ARENA_MEGABYTES };
+		uint64_t playouts = 0, nodes = 0;
+		double total_seconds = 0;
+		int full = 0;
+		for (int i = 0; i < fen_count; i++) {
+			mcts_result_t result = mcts_search(&games[i].bitboard, games[i].current_turn, &limits);
+			playouts += result.playouts;
+			nodes += result.nodes;
+			total_seconds += result.seconds;
+			full += result.arena_full;
+		}
+		double pps = (total_seconds > 0) ? playouts / total_seconds : 0;
+		printf("%d\t%llu\t%llu\t%.6f\t%.0f\t%.0f\t%.0f\t%d\n", threads, (unsigned long long)playouts,
+			(unsigned long long)nodes, total_seconds, pps, (total_seconds > 0) ? nodes / total_seconds : 0, pps / threads, full);
+		fflush(stdout);
+	}
+
+	free(games);
+	return 0;
+}
@@ -1,8 +1,5 @@
-/*
- * The game is based on the standard U.S. rules for checkers:
- * http://boardgames.about.com/cs/checkersdraughts/ht/play_checkers.htm
- */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <SDL2/SDL.h>
@@ -14,8 +11,10 @@
 
 #include "startup.h"
 #include "network.h"
-
-#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+#include "game.h"
+#include "search.h"
+#include "thread.h"
+#include "book.h"
 
 struct textures {
 	SDL_Texture *board;
@@ -35,26 +34,6 @@ typedef union {
 	SDL_Texture *array[sizeof(struct textures) / sizeof(SDL_Texture *)];
 } textures_t;
 
-// red pieces start at bottom side of the board, whites at top
-typedef enum { PIECE_BLACK, PIECE_WHITE } piece_color_t;
-
-typedef struct {
-	piece_color_t color;
-	bool captured;
-	bool king;
-	cell_pos_t pos;
-} piece_t;
-
-typedef struct {
-	cell_pos_t pos;
-	piece_t *capture;
-} move_t;
-
-typedef struct {
-	move_t moves[4];
-	int count;
-} piece_moves_t;
-
 // SDL handles
 static SDL_Window *window;
 static SDL_Renderer *renderer;
@@ -62,21 +41,19 @@ static textures_t tex;
 static net_context_t *network;
 
 // Game logic state
-static bool game_over;
-static piece_color_t current_turn;
+static game_state_t game;
 static piece_color_t local_color;
-static piece_t pieces[24];
-static piece_t *board[8][8];
-static int must_capture_count;
-static piece_t *must_capture[10];
 
 // GUI state
 static piece_t *selected_piece;
 static piece_moves_t available_moves;
 static bool changed_turn;
+static message_t turn_path; // hops made by the local player in the current turn
 static piece_t *animating_piece;
-static piece_t *animating_capture;
-static cell_pos_t animating_from;
+static piece_t *animating_captures[BB_MAX_HOPS];
+static int animating_capture_count;
+static cell_pos_t animating_path[MESSAGE_MAX_PATH];
+static int animating_path_length;
 static float animating_t;
 
 // Rendering parameters
@@ -115,15 +92,6 @@ static bool rect_includes(SDL_Rect *rect, int x, int y) {
 	return result;
 }
 
-static void advance_board_row_col(int *row, int *col) {
-	if (*col >= 6) {
-		*col = (*col % 2 == 0) ? 1 : 0;
-		(*row)++;
-	} else {
-		*col += 2;
-	}
-}
-
 static float lerp(float a, float b, float t) {
 	return (1-t)*a + t*b;
 }
@@ -198,169 +166,151 @@ static void window_resized(int width, int height) {
 	cell_size = board_rect.w / 8;
 }
 
-static bool valid_cell(cell_pos_t pos) {
-	return (pos.row >= 0 && pos.row < 8) && (pos.col >= 0 && pos.col < 8);
-}
-
-static void find_move_at_direction(piece_moves_t *moves, piece_t *piece, int row_dir, int col_dir) {
-	cell_pos_t cur_pos = piece->pos;
-	cell_pos_t move_pos = cell_pos(cur_pos.row + row_dir, cur_pos.col + col_dir);
-	cell_pos_t cap_pos = cell_pos(move_pos.row + row_dir, move_pos.col + col_dir);
-	if (valid_cell(move_pos)) {
-		piece_t *other = board[move_pos.row][move_pos.col];
-		if (other) {
-			if (valid_cell(cap_pos) &&
-				other->color != piece->color &&
-				!board[cap_pos.row][cap_pos.col]
-			) {
-				move_t move = { cap_pos, other };
-				moves->moves[moves->count++] = move;
-			}
-		} else {
-			move_t move = { move_pos, 0 };
-			moves->moves[moves->count++] = move;
+// Animates the piece along the path, the pieces it jumped over are looked up
+// in the state from before the move and faded out. A hop only passes over a
+// piece when it captures it, a flying king's capture can start and end
+// several cells away from that piece.
+static void start_move_animation(const game_state_t *before, const cell_pos_t *path, int path_length, move_result_t res) {
+	animating_piece = game.pieces + before->board[path[0].row][path[0].col];
+	animating_capture_count = 0;
+	for (int i = 1; i < path_length; i++) {
+		cell_pos_t a = path[i - 1];
+		cell_pos_t b = path[i];
+		int row_dir = (b.row > a.row) ? 1 : -1;
+		int col_dir = (b.col > a.col) ? 1 : -1;
+		for (int row = a.row + row_dir, col = a.col + col_dir; row != b.row; row += row_dir, col += col_dir) {
+			int8_t index = before->board[row][col];
+			if (index >= 0 && animating_capture_count < BB_MAX_HOPS)
+				animating_captures[animating_capture_count++] = game.pieces + index;
 		}
+		animating_path[i - 1] = a;
 	}
+	animating_path[path_length - 1] = path[path_length - 1];
+	animating_path_length = path_length;
+	animating_t = 0;
+	changed_turn = (res == MOVE_END_TURN);
 }
 
-// Get the possible moves for the piece, if any capture move is found only the
-// capture moves are returned. This function does not check the case when the
-// player is required to make a capture with a piece other than the piece tested.
-static piece_moves_t find_local_moves(piece_t *piece) {
-	piece_moves_t result = {0};
-
-	if (piece->color == PIECE_WHITE || piece->king) {
-		find_move_at_direction(&result, piece, 1, 1);
-		find_move_at_direction(&result, piece, 1, -1);
-	}
-	if (piece->color == PIECE_BLACK || piece->king) {
-		find_move_at_direction(&result, piece, -1, 1);
-		find_move_at_direction(&result, piece, -1, -1);
-	}
-
-	bool has_capture = false;
-	for (int i = 0; i < result.count; i++) {
-		if (result.moves[i].capture) {
-			has_capture = true;
-			break;
-		}
-	}
-
-	if (has_capture) {
-		// remove non-capture moves
-		int new_count = 0;
-		for (int i = 0; i < result.count; i++) {
-			if (result.moves[i].capture) {
-				result.moves[new_count++] = result.moves[i];
-			}
-		}
-		result.count = new_count;
+static bool message_to_move(const message_t *msg, bb_move_t *move) {
+	if (msg->path_length < 2 || msg->path_length > BB_MAX_HOPS + 1)
+		return false;
+	memset(move, 0, sizeof(*move));
+	move->length = msg->path_length - 1;
+	for (int i = 0; i < msg->path_length; i++) {
+		int square = bb_square(msg->path[i]);
+		if (square < 0)
+			return false;
+		move->path[i] = (uint8_t)square;
 	}
+	return true;
+}
 
-	return result;
+static void log_error(char *prefix, const char *message) {
+	fprintf(stderr, "ERROR %s: %s\n", prefix, message);
 }
 
-// This function finds the moves taking in consideration required captures
-static piece_moves_t find_valid_moves(piece_t *piece) {
-	piece_moves_t result = {0};
-	bool piece_can_move = true;
-	if (must_capture_count) {
-		piece_can_move = false;
-		for (int i = 0; i < must_capture_count; i++) {
-			if (must_capture[i] == piece) {
-				piece_can_move = true;
-				break;
-			}
-		}
-	}
-	if (piece_can_move) {
-		result = find_local_moves(piece);
-	}
-	return result;
+// AI opponent, searched in a background thread so the window keeps rendering
+static search_limits_t ai_limits;
+static tt_t *ai_tt;
+static tablebase_t *ai_tb;
+static book_t *ai_book;
+static nn_t *ai_nn;
+static game_state_t ai_position;
+static search_result_t ai_result;
+static SDL_Thread *ai_thread;
+static SDL_atomic_t ai_done;
+static search_control_t ai_control;
+static bool ai_pondering; // ai_position is the reply the last search expects
+static Uint32 ai_think_start; // ticks when the computer's clock started on the move
+
+static int ai_search_proc(void *data) {
+	ai_result = search(&ai_position.bitboard, ai_position.current_turn, &ai_limits, ai_tt, ai_tb);
+	SDL_AtomicSet(&ai_done, 1);
+	return 0;
 }
 
-typedef enum { MOVE_INVALID, MOVE_CONTINUE_TURN, MOVE_END_TURN } move_result_t;
-static move_result_t perform_move(piece_t *piece, cell_pos_t target) {
-	move_result_t result = MOVE_INVALID;
-
-	piece_moves_t moves = find_valid_moves(piece);
-	move_t *move = 0;
-	for (int i = 0; i < moves.count; i++) {
-		move_t *test = moves.moves + i;
-		if (test->pos.row == target.row && test->pos.col == target.col) {
-			move = test;
-			break;
-		}
+// Takes the time of a move off the clock, when playing with one, and adds the
+// increment. The time manager keeps the clock from running out, but an
+// overrun still leaves a little time to the next move.
+static void charge_ai_clock(double seconds) {
+	if (ai_limits.clock > 0) {
+		ai_limits.clock += ai_limits.increment - seconds;
+		if (ai_limits.clock < 0.01)
+			ai_limits.clock = 0.01;
 	}
+}
 
-	if (move) {
-		animating_piece = piece;
-		animating_capture = move->capture;
-		animating_from = piece->pos;
-		animating_t = 0;
-
-		board[piece->pos.row][piece->pos.col] = 0;
-		board[move->pos.row][move->pos.col] = piece;
-		piece->pos = move->pos;
-
-		if ((piece->color == PIECE_BLACK && move->pos.row == 0) ||
-			(piece->color == PIECE_WHITE && move->pos.row == 7))
-			piece->king = true;
+static void start_ai_search(const game_state_t *position, bool ponder) {
+	ai_position = *position;
+	ai_pondering = ponder;
+	thread_atomic_set(&ai_control.stop, 0);
+	thread_atomic_set(&ai_control.pondering, ponder);
+	ai_think_start = SDL_GetTicks();
+	SDL_AtomicSet(&ai_done, 0);
+	ai_thread = SDL_CreateThread(ai_search_proc, "ai", 0);
+	if (!ai_thread)
+		log_error("SDL_CreateThread ai", SDL_GetError());
+}
 
-		bool end_turn = true;
-		if (move->capture) {
-			board[move->capture->pos.row][move->capture->pos.col] = 0;
-			move->capture->captured = true;
+static void stop_ai_search(void) {
+	if (ai_thread) {
+		thread_atomic_set(&ai_control.stop, 1);
+		SDL_WaitThread(ai_thread, 0);
+		ai_thread = 0;
+	}
+	ai_pondering = false;
+}
 
-			piece_moves_t moves_after = find_local_moves(piece);
-			if (moves_after.count > 0 && moves_after.moves[0].capture) {
-				end_turn = false;
-			}
-		}
+// While the player thinks, searches the position after the reply the last
+// search expects. The time limits don't apply until that reply is played.
+static void start_pondering(void) {
+	if (ai_thread || !ai_result.ponder_found)
+		return;
+	ai_result.ponder_found = false; // once per move, the player may be in the middle of a turn later
+	game_state_t position = game;
+	if (perform_turn(&position, &ai_result.ponder_move) != MOVE_INVALID && !position.game_over)
+		start_ai_search(&position, true);
+}
 
-		if (end_turn) {
-			current_turn = (current_turn == PIECE_BLACK) ? PIECE_WHITE : PIECE_BLACK;
-			changed_turn = true;
+// Plays from the book right away when it has the position, otherwise starts
+// searching it on the first call, returns true and the move to play once the
+// search is over. A ponder search goes on if the player made the expected
+// move and is thrown away otherwise.
+static bool poll_ai_move(bb_move_t *move) {
+	bool result = false;
+	if (ai_pondering) {
+		if (game.hash == ai_position.hash) {
+			thread_atomic_set(&ai_control.pondering, 0);
+			ai_think_start = SDL_GetTicks();
+			ai_pondering = false;
 		} else {
-			changed_turn = false;
-		}
-
-		bool can_move = false;
-		must_capture_count = 0;
-		for (int i = 0; i < 32; i++) {
-			piece_t *test = pieces + i;
-			if (test->color == current_turn && !test->captured) {
-				piece_moves_t moves = find_local_moves(test);
-				if (moves.count) {
-					can_move = true;
-					if (moves.moves[0].capture) {
-						must_capture[must_capture_count++] = test;
-					}
-				}
-			}
+			stop_ai_search();
 		}
-
-		// the player lose when there is no move available
-		if (end_turn && !can_move)
-			game_over = true;
-
-		result = end_turn ? MOVE_END_TURN : MOVE_CONTINUE_TURN;
 	}
 
+	if (!ai_thread && ai_book && book_probe(ai_book, &game.bitboard, game.current_turn, SDL_GetTicks(), move)) {
+		ai_result.ponder_found = false;
+		charge_ai_clock(0);
+		result = true;
+	} else if (!ai_thread) {
+		start_ai_search(&game, false);
+	} else if (SDL_AtomicGet(&ai_done)) {
+		SDL_WaitThread(ai_thread, 0);
+		ai_thread = 0;
+		*move = ai_result.best_move;
+		result = ai_result.found;
+		charge_ai_clock((SDL_GetTicks() - ai_think_start) / 1000.0);
+	}
 	return result;
 }
 
-static void log_error(char *prefix, const char *message) {
-	fprintf(stderr, "ERROR %s: %s\n", prefix, message);
-}
-
 static void render(float dt) {
 	SDL_SetRenderDrawColor(renderer, 0xde, 0xde, 0xde, 0xff);
 	SDL_RenderClear(renderer);
 
 	SDL_RenderCopy(renderer, tex.textures.board, 0, &outer_board_rect);
 
-	if (current_turn == local_color) {
+	if (game.current_turn == local_color) {
 		if (selected_piece) {
 			SDL_Rect rect = {0};
 			cell_to_rect(selected_piece->pos, &rect);
@@ -372,9 +322,9 @@ static void render(float dt) {
 				SDL_RenderFillRect(renderer, &rect);
 			}
 		}
-		if (must_capture_count && !animating_piece) {
-			for (int i = 0; i < must_capture_count; i++) {
-				piece_t *piece = must_capture[i];
+		if (game.must_capture_count && !animating_piece) {
+			for (int i = 0; i < game.must_capture_count; i++) {
+				piece_t *piece = game.pieces + game.must_capture[i];
 				if (piece != selected_piece) {
 					SDL_Rect rect = {0};
 					cell_to_rect(piece->pos, &rect);
@@ -385,38 +335,41 @@ static void render(float dt) {
 	}
 
 	if (animating_piece) {
-		animating_t += dt * 3;
+		int hops = animating_path_length - 1;
+		animating_t += dt * 3 / hops;
 
 		if (animating_t >= 1.0) {
 			animating_piece = 0;
-			animating_capture = 0;
+			animating_capture_count = 0;
 			animating_t = 0;
 		} else {
-			if (animating_capture) {
+			for (int i = 0; i < animating_capture_count; i++) {
 				SDL_Rect rect;
-				cell_to_rect(animating_capture->pos, &rect);
-				SDL_Texture *texture = texture_for_piece(animating_capture);
+				cell_to_rect(animating_captures[i]->pos, &rect);
+				SDL_Texture *texture = texture_for_piece(animating_captures[i]);
 				SDL_SetTextureAlphaMod(texture, (Uint8)((1 - animating_t) * 0xff));
 				SDL_RenderCopy(renderer, texture, 0, &rect);
 				SDL_SetTextureAlphaMod(texture, 0xff);
 			}
 
+			int hop = (int)(animating_t * hops);
+			float hop_t = animating_t * hops - hop;
 			SDL_Rect from_rect = {0};
 			SDL_Rect to_rect = {0};
-			cell_to_rect(animating_from, &from_rect);
-			cell_to_rect(animating_piece->pos, &to_rect);
+			cell_to_rect(animating_path[hop], &from_rect);
+			cell_to_rect(animating_path[hop + 1], &to_rect);
 
 			SDL_Rect lerp_rect;
-			lerp_rect.x = (int)lerp(from_rect.x, to_rect.x, animating_t);
-			lerp_rect.y = (int)lerp(from_rect.y, to_rect.y, animating_t);
+			lerp_rect.x = (int)lerp(from_rect.x, to_rect.x, hop_t);
+			lerp_rect.y = (int)lerp(from_rect.y, to_rect.y, hop_t);
 			lerp_rect.w = cell_size;
 			lerp_rect.h = cell_size;
 			SDL_RenderCopy(renderer, texture_for_piece(animating_piece), 0, &lerp_rect);
 		}
 	}
 
-	for (int i = 0; i < ARRAY_SIZE(pieces); i++) {
-		piece_t *piece = pieces + i;
+	for (int i = 0; i < ARRAY_SIZE(game.pieces); i++) {
+		piece_t *piece = game.pieces + i;
 		if (!piece->captured && piece != animating_piece) {
 			SDL_Rect rect = {0};
 			cell_to_rect(piece->pos, &rect);
@@ -424,8 +377,8 @@ static void render(float dt) {
 		}
 	}
 
-	if (game_over) {
-		SDL_Texture *msg_tex = (current_turn == local_color) ? tex.textures.defeat : tex.textures.victory;
+	if (game.game_over) {
+		SDL_Texture *msg_tex = (game.current_turn == local_color) ? tex.textures.defeat : tex.textures.victory;
 		int twidth, theight;
 		SDL_QueryTexture(msg_tex, 0, 0, &twidth, &theight);
 		SDL_Rect msg_rect = {0};
@@ -443,7 +396,7 @@ static void render(float dt) {
 	} else {
 		SDL_Texture *current_turn_tex = 0;
 		SDL_Texture *past_turn_tex = 0;
-		if (current_turn == local_color) {
+		if (game.current_turn == local_color) {
 			current_turn_tex = tex.textures.player_turn;
 			past_turn_tex = tex.textures.opponent_turn;
 		} else {
@@ -499,7 +452,9 @@ int main(int argc, char **argv) {
 	network = info.network;
 
 	char wtitle[256];
-	if (net_mode == NET_SERVER) {
+	if (info.ai_opponent) {
+		snprintf(wtitle, sizeof(wtitle), "NetCheckers - computer (depth %d)", info.ai_depth);
+	} else if (net_mode == NET_SERVER) {
 		snprintf(wtitle, sizeof(wtitle), "NetCheckers - server (%s)", info.port);
 	} else {
 		snprintf(wtitle, sizeof(wtitle), "NetCheckers - client (%s:%s)", info.host, info.port);
@@ -543,49 +498,27 @@ int main(int argc, char **argv) {
 
 	window_resized(window_width, window_height);
 
-// Put the pieces on the board
-#if 0
-	// Game over testing
-	for (int i = 0; i < 24; i++) {
-		piece_t *piece = pieces + i;
-		piece->color = (i >= 12) ? PIECE_BLACK : PIECE_WHITE;
-		piece->captured = true;
-	}
-	pieces[0].captured = false;
-	pieces[0].king = true;
-	pieces[0].pos = cell_pos(1, 3);
-	board[1][3] = &pieces[0];
-
-	pieces[12].captured = false;
-	pieces[12].king = true;
-	pieces[12].pos = cell_pos(5, 3);
-	board[5][3] = &pieces[12];
-#else
-	int fill_row = 0;
-	int fill_col = 0;
-
-	for (int i = 0; i < 12; i++) {
-		piece_t *piece = pieces + i;
-		piece->color = PIECE_WHITE;
-		piece->pos = cell_pos(fill_row, fill_col);
-		board[fill_row][fill_col] = piece;
-		advance_board_row_col(&fill_row, &fill_col);
-	}
-
-	fill_row = 5;
-	fill_col = 1;
-	for (int i = 12; i < 24; i++) {
-		piece_t *piece = pieces + i;
-		piece->color = PIECE_BLACK;
-		piece->pos = cell_pos(fill_row, fill_col);
-		board[fill_row][fill_col] = piece;
-		advance_board_row_col(&fill_row, &fill_col);
+	game_init(&game);
+	local_color = (net_mode == NET_SERVER || info.ai_opponent) ? PIECE_BLACK : PIECE_WHITE;
+	ai_limits.depth = info.ai_depth;
+	ai_limits.time_limit = info.ai_time_limit;
+	ai_limits.threads = info.ai_threads;
+	ai_limits.clock = info.ai_clock;
+	ai_limits.increment = info.ai_increment;
+	ai_limits.control = &ai_control;
+	if (info.ai_opponent) {
+		ai_tt = tt_create(info.ai_hash_mb);
+		if (!ai_tt)
+			goto exit;
+		ai_tb = tb_open(info.tablebase_path);
+		if (ai_tb && tb_max_pieces(ai_tb) == 0) {
+			tb_close(ai_tb);
+			ai_tb = 0;
+		}
+		ai_book = book_open(info.book_path);
+		ai_nn = nn_open(info.nn_path);
+		ai_limits.nn = ai_nn;
 	}
-#endif
-
-	game_over = false;
-	current_turn = PIECE_BLACK;
-	local_color = (net_mode == NET_SERVER) ? PIECE_BLACK : PIECE_WHITE;
 
 	bool running = true;
 	int last_time = SDL_GetTicks();
@@ -608,22 +541,23 @@ int main(int argc, char **argv) {
 				} break;
 				case SDL_MOUSEBUTTONDOWN: {
 					#if 1
-					if (event.button.state == SDL_PRESSED && event.button.button == SDL_BUTTON_RIGHT) {
+					if (network && event.button.state == SDL_PRESSED && event.button.button == SDL_BUTTON_RIGHT) {
 						message_t net_msg = {0};
-						net_msg.move_piece = cell_pos(5, 1);
-						net_msg.move_target = cell_pos(4, 0);
+						net_msg.path[0] = cell_pos(5, 1);
+						net_msg.path[1] = cell_pos(4, 0);
+						net_msg.path_length = 2;
 						net_send_message(network, &net_msg);
 					}
 					#endif
 					if (event.button.state == SDL_PRESSED && event.button.button == SDL_BUTTON_LEFT) {
-						if (!game_over && !animating_piece && current_turn == local_color) {
+						if (!game.game_over && !animating_piece && game.current_turn == local_color) {
 							int click_x = event.button.x * dpi_rate;
 							int click_y = event.button.y * dpi_rate;
 							if (rect_includes(&board_rect, click_x, click_y)) {
 								cell_pos_t clicked_cell = point_to_cell(click_x, click_y);
-								piece_t *clicked_piece = board[clicked_cell.row][clicked_cell.col];
-								if (clicked_piece && clicked_piece->color == current_turn) {
-									piece_moves_t moves = find_valid_moves(clicked_piece);
+								piece_t *clicked_piece = game_piece_at(&game, clicked_cell);
+								if (clicked_piece && clicked_piece->color == game.current_turn) {
+									piece_moves_t moves = find_valid_moves(&game, clicked_cell);
 									if (moves.count) {
 										selected_piece = clicked_piece;
 										available_moves = moves;
@@ -631,18 +565,28 @@ int main(int argc, char **argv) {
 								} else if (selected_piece) {
 									cell_pos_t from_cell = selected_piece->pos;
 
-									move_result_t res = perform_move(selected_piece, clicked_cell);
+									game_state_t before = game;
+									move_result_t res = perform_move(&game, from_cell, clicked_cell, 0);
 									if (res != MOVE_INVALID) {
+										cell_pos_t hop_path[2] = { from_cell, clicked_cell };
+										start_move_animation(&before, hop_path, 2, res);
+
+										if (turn_path.path_length == 0)
+											turn_path.path[turn_path.path_length++] = from_cell;
+										turn_path.path[turn_path.path_length++] = clicked_cell;
+
 										if (res == MOVE_END_TURN) {
 											selected_piece = 0;
 										} else {
-											available_moves = find_valid_moves(selected_piece);
+											available_moves = find_valid_moves(&game, clicked_cell);
 										}
+									}
 
-										message_t net_msg = {0};
-										net_msg.move_piece = from_cell;
-										net_msg.move_target = clicked_cell;
-										if (!net_send_message(network, &net_msg)) {
+									// the opponent receives the whole turn in a single message
+									if (res == MOVE_END_TURN) {
+										bool sent = !network || net_send_message(network, &turn_path);
+										turn_path.path_length = 0;
+										if (!sent) {
 											int err = SDL_ShowSimpleMessageBox(
 												SDL_MESSAGEBOX_ERROR,
 												"Erro - Falha de comunicação",
@@ -663,7 +607,7 @@ int main(int argc, char **argv) {
 			}
 		}
 
-		if (net_get_state(network) != NET_RUNNING) {
+		if (network && net_get_state(network) != NET_RUNNING) {
 			int err = SDL_ShowSimpleMessageBox(
 				SDL_MESSAGEBOX_ERROR,
 				"Erro - Conexão Interrompida",
@@ -677,14 +621,17 @@ int main(int argc, char **argv) {
 		}
 
 		message_t net_msg;
-		if (net_poll_message(network, &net_msg)) {
+		if (network && net_poll_message(network, &net_msg)) {
 			bool valid_move = false;
 
-			piece_t *piece = board[net_msg.move_piece.row][net_msg.move_piece.col];
-			if (piece && current_turn != local_color && piece->color != local_color) {
-				move_result_t res = perform_move(piece, net_msg.move_target);
-				if (res != MOVE_INVALID)
+			bb_move_t move;
+			if (game.current_turn != local_color && message_to_move(&net_msg, &move)) {
+				game_state_t before = game;
+				move_result_t res = perform_turn(&game, &move);
+				if (res != MOVE_INVALID) {
+					start_move_animation(&before, net_msg.path, net_msg.path_length, res);
 					valid_move = true;
+				}
 			}
 
 			if (!valid_move) {
@@ -701,11 +648,36 @@ int main(int argc, char **argv) {
 			}
 		}
 
+		if (info.ai_opponent && !game.game_over && !animating_piece && game.current_turn != local_color) {
+			bb_move_t move;
+			if (poll_ai_move(&move)) {
+				cell_pos_t path[BB_MAX_HOPS + 1];
+				for (int i = 0; i <= move.length; i++)
+					path[i] = bb_cell(move.path[i]);
+
+				game_state_t before = game;
+				move_result_t res = perform_turn(&game, &move);
+				if (res != MOVE_INVALID)
+					start_move_animation(&before, path, move.length + 1, res);
+			}
+		} else if (info.ai_opponent && !game.game_over && game.current_turn == local_color) {
+			start_pondering();
+		}
+
 		render(delta_time);
 	}
 
 	return_status = 0;
 exit:
+	stop_ai_search();
+	if (ai_tt)
+		tt_destroy(ai_tt);
+	if (ai_tb)
+		tb_close(ai_tb);
+	if (ai_book)
+		book_close(ai_book);
+	if (ai_nn)
+		nn_close(ai_nn);
 	if (network)
 		net_destroy(network);
 	for (int i = 0; i < ARRAY_SIZE(tex.array); i++) {
@@ -240,14 +240,22 @@ static int connection_proc(void *data) {
 				set_error(net, NET_EUNKNOWN, "received message isn't null terminated");
 				goto exit;
 			}
-			// parse message
-			int status = sscanf(
-				buffer,
-				"MOVE %d %d TO %d %d",
-				&msg.move_piece.row, &msg.move_piece.col,
-				&msg.move_target.row, &msg.move_target.col
-			);
-			if (status != 4) {
+			// parse message: MOVE row col TO row col [TO row col ...]
+			int offset = 0;
+			int status = sscanf(buffer, "MOVE %d %d%n", &msg.path[0].row, &msg.path[0].col, &offset);
+			msg.path_length = 1;
+			while (status == 2 && buffer[offset]) {
+				if (msg.path_length == MESSAGE_MAX_PATH) {
+					set_error(net, NET_EUNKNOWN, "received move is too long");
+					goto exit;
+				}
+				cell_pos_t *cell = msg.path + msg.path_length++;
+				int read = 0;
+				if (sscanf(buffer + offset, " TO %d %d%n", &cell->row, &cell->col, &read) != 2)
+					status = 0;
+				offset += read;
+			}
+			if (status != 2 || buffer[offset] || msg.path_length < 2) {
 				set_error(net, NET_EUNKNOWN, "failed to parse message");
 				goto exit;
 			}
@@ -259,12 +267,9 @@ static int connection_proc(void *data) {
 		if (FD_ISSET(net->sock, &write_fds)) {
 			message_t msg;
 			if (dequeue(&net->send_queue, &msg)) {
-				int msg_len = sprintf(
-					buffer,
-					"MOVE %d %d TO %d %d",
-					msg.move_piece.row, msg.move_piece.col,
-					msg.move_target.row, msg.move_target.col
-				);
+				int msg_len = sprintf(buffer, "MOVE %d %d", msg.path[0].row, msg.path[0].col);
+				for (int i = 1; i < msg.path_length; i++)
+					msg_len += sprintf(buffer + msg_len, " TO %d %d", msg.path[i].row, msg.path[i].col);
 				ssize_t wc = send(net->sock, buffer, msg_len + 1, 0);
 				if (wc == SOCKET_ERROR) {
 					set_error(net, NET_EUNKNOWN, "send", sock_error_str());
@@ -1,10 +1,14 @@
 #pragma once
 #include <stdbool.h>
 #include "common.h"
+#include "bitboard.h"
 
+#define MESSAGE_MAX_PATH (BB_MAX_HOPS + 1)
+
+// A whole turn: the cells visited by the moving piece, path[0] is where it starts
 typedef struct {
-	cell_pos_t move_piece;
-	cell_pos_t move_target;
+	cell_pos_t path[MESSAGE_MAX_PATH];
+	int path_length;
 } message_t;
 
 typedef struct _net_context net_context_t;
@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nn.h"
+#include "file_map.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define HAVE_SIMD_KERNELS
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define TARGET_AVX2 // MSVC takes the intrinsics without a compiler flag
+		#define TARGET_SSSE3
+	#else
+		#define TARGET_AVX2 __attribute__((target("avx2")))
+		#define TARGET_SSSE3 __attribute__((target("ssse3")))
+	#endif
+#endif
+
+#define NN_MAGIC "NCNN"
+#define NN_VERSION 1
+#define HEADER_SIZE 16
+#define FILE_SIZE (HEADER_SIZE + NN_INPUTS * NN_HIDDEN * 2 + NN_HIDDEN * 2 \
+	+ NN_LAYER * NN_HIDDEN + NN_LAYER * 4 + NN_LAYER * NN_LAYER + NN_LAYER * 4 + NN_LAYER + 4)
+
+#define CLIP(x) ((x) < 0 ? 0 : (x) > 127 ? 127 : (x))
+
+struct _nn {
+	int16_t accumulator_weights[NN_INPUTS][NN_HIDDEN];
+	int16_t accumulator_biases[NN_HIDDEN];
+	int8_t layer1_weights[NN_LAYER][NN_HIDDEN];
+	int32_t layer1_biases[NN_LAYER];
+	int8_t layer2_weights[NN_LAYER][NN_LAYER];
+	int32_t layer2_biases[NN_LAYER];
+	int8_t output_weights[NN_LAYER];
+	int32_t output_bias;
+	nn_kernel_t kernel;
+};
+
+// Sums of the bias and the products of the inputs with each row of weights.
+// Inputs are 0..127 and weights -128..127, so the int16 sums of two products
+// the SIMD kernels make first can't saturate.
+static void layer_scalar(const uint8_t *input, int inputs, const int8_t *weights, const int32_t *biases, int outputs, int32_t *sums) {
+	for (int o = 0; o < outputs; o++) {
+		int32_t sum = biases[o];
+		for (int i = 0; i < inputs; i++)
+			sum += input[i] * weights[o * inputs + i];
+		sums[o] = sum;
+	}
+}
+
+#ifdef HAVE_SIMD_KERNELS
+
+// The products of a row with the inputs, summed in eight int32 lanes
+TARGET_AVX2 static inline __m256i dot_avx2(const uint8_t *input, const int8_t *row, int inputs) {
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+	for (int i = 0; i < inputs; i += 32) {
+		__m256i products = _mm256_maddubs_epi16(
+			_mm256_loadu_si256((const __m256i *)(input + i)),
+			_mm256_loadu_si256((const __m256i *)(row + i)));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+	}
+	return sum;
+}
+
+// Inputs come in multiples of 32. Rows are summed four at a time, so the
+// horizontal additions are shared.
+TARGET_AVX2 static void layer_avx2(const uint8_t *input, int inputs, const int8_t *weights, const int32_t *biases, int outputs, int32_t *sums) {
+	int o = 0;
+	for (; o + 4 <= outputs; o += 4) {
+		const int8_t *rows = weights + o * inputs;
+		__m256i sum = _mm256_hadd_epi32(
+			_mm256_hadd_epi32(dot_avx2(input, rows, inputs), dot_avx2(input, rows + inputs, inputs)),
+			_mm256_hadd_epi32(dot_avx2(input, rows + 2 * inputs, inputs), dot_avx2(input, rows + 3 * inputs, inputs)));
+		__m128i four = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+		four = _mm_add_epi32(four, _mm_loadu_si128((const __m128i *)(biases + o)));
+		_mm_storeu_si128((__m128i *)(sums + o), four);
+	}
+	for (; o < outputs; o++) {
+		__m256i sum = dot_avx2(input, weights + o * inputs, inputs);
+		__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+		sums[o] = biases[o] + _mm_cvtsi128_si32(half);
+	}
+}
+
+// Inputs come in multiples of 16
+TARGET_SSSE3 static void layer_ssse3(const uint8_t *input, int inputs, const int8_t *weights, const int32_t *biases, int outputs, int32_t *sums) {
+	const __m128i ones = _mm_set1_epi16(1);
+	for (int o = 0; o < outputs; o++) {
+		const int8_t *row = weights + o * inputs;
+		__m128i sum = _mm_setzero_si128();
+		for (int i = 0; i < inputs; i += 16) {
+			__m128i products = _mm_maddubs_epi16(
+				_mm_loadu_si128((const __m128i *)(input + i)),
+				_mm_loadu_si128((const __m128i *)(row + i)));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+		}
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+		sums[o] = biases[o] + _mm_cvtsi128_si32(sum);
+	}
+}
+
+static nn_kernel_t cpu_kernel(void) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	bool ssse3 = (info[2] & (1 << 9)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (osxsave && (_xgetbv(0) & 6) == 6) { // the OS saves the YMM registers
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			return NN_KERNEL_AVX2;
+	}
+	return ssse3 ? NN_KERNEL_SSSE3 : NN_KERNEL_SCALAR;
+#else
+	if (__builtin_cpu_supports("avx2"))
+		return NN_KERNEL_AVX2;
+	if (__builtin_cpu_supports("ssse3"))
+		return NN_KERNEL_SSSE3;
+	return NN_KERNEL_SCALAR;
+#endif
+}
+
+#endif
+
+static void layer(nn_kernel_t kernel, const uint8_t *input, int inputs, const int8_t *weights, const int32_t *biases, int outputs, int32_t *sums) {
+#ifdef HAVE_SIMD_KERNELS
+	if (kernel == NN_KERNEL_AVX2) {
+		layer_avx2(input, inputs, weights, biases, outputs, sums);
+		return;
+	}
+	if (kernel == NN_KERNEL_SSSE3) {
+		layer_ssse3(input, inputs, weights, biases, outputs, sums);
+		return;
+	}
+#endif
+	layer_scalar(input, inputs, weights, biases, outputs, sums);
+}
+
+extern nn_kernel_t nn_best_kernel(void) {
+#ifdef HAVE_SIMD_KERNELS
+	static int kernel = -1; // computed once, every thread gets the same answer
+	if (kernel < 0)
+		kernel = cpu_kernel();
+	return (nn_kernel_t)kernel;
+#else
+	return NN_KERNEL_SCALAR;
+#endif
+}
+
+extern const char *nn_kernel_name(nn_kernel_t kernel) {
+	return (kernel == NN_KERNEL_AVX2) ? "avx2" : (kernel == NN_KERNEL_SSSE3) ? "ssse3" : "scalar";
+}
+
+// Signed little endian values of 1, 2 or 4 bytes, returns the data after them
+static const uint8_t *read_values(const uint8_t *p, int bytes, int count, void *values) {
+	for (int i = 0; i < count; i++, p += bytes) {
+		uint32_t value = 0;
+		for (int b = bytes - 1; b >= 0; b--)
+			value = value << 8 | p[b];
+		if (bytes == 1)
+			((int8_t *)values)[i] = (int8_t)value;
+		else if (bytes == 2)
+			((int16_t *)values)[i] = (int16_t)value;
+		else
+			((int32_t *)values)[i] = (int32_t)value;
+	}
+	return p;
+}
+
+extern nn_t *nn_open(const char *path) {
+	file_map_t map;
+	if (!file_map_open(&map, path))
+		return 0;
+	const uint8_t *data = map.data;
+	if (map.size != FILE_SIZE || memcmp(data, NN_MAGIC, 4) != 0 || data[4] != NN_VERSION
+		|| data[8] + (data[9] << 8) != NN_INPUTS || data[10] + (data[11] << 8) != NN_HIDDEN
+		|| data[12] + (data[13] << 8) != NN_LAYER) {
+		fprintf(stderr, "ERROR invalid network file: %s\n", path);
+		file_map_close(&map);
+		return 0;
+	}
+	nn_t *nn = calloc(1, sizeof(nn_t));
+	if (!nn) {
+		perror("ERROR calloc");
+		file_map_close(&map);
+		return 0;
+	}
+	// copied out of the mapping, the weights are small and aligned this way
+	const uint8_t *p = data + HEADER_SIZE;
+	p = read_values(p, 2, NN_INPUTS * NN_HIDDEN, nn->accumulator_weights);
+	p = read_values(p, 2, NN_HIDDEN, nn->accumulator_biases);
+	p = read_values(p, 1, NN_LAYER * NN_HIDDEN, nn->layer1_weights);
+	p = read_values(p, 4, NN_LAYER, nn->layer1_biases);
+	p = read_values(p, 1, NN_LAYER * NN_LAYER, nn->layer2_weights);
+	p = read_values(p, 4, NN_LAYER, nn->layer2_biases);
+	p = read_values(p, 1, NN_LAYER, nn->output_weights);
+	read_values(p, 4, 1, &nn->output_bias);
+	file_map_close(&map);
+	nn->kernel = nn_best_kernel();
+	return nn;
+}
+
+extern void nn_close(nn_t *nn) {
+	free(nn);
+}
+
+extern nn_kernel_t nn_kernel(const nn_t *nn) {
+	return nn->kernel;
+}
+
+extern void nn_set_kernel(nn_t *nn, nn_kernel_t kernel) {
+	nn->kernel = kernel;
+}
+
+static void add_feature(const nn_t *nn, nn_accumulator_t *acc, int feature) {
+	const int16_t *weights = nn->accumulator_weights[feature];
+	for (int i = 0; i < NN_HIDDEN; i++)
+		acc->values[i] = (int16_t)(acc->values[i] + weights[i]);
+}
+
+static void sub_feature(const nn_t *nn, nn_accumulator_t *acc, int feature) {
+	const int16_t *weights = nn->accumulator_weights[feature];
+	for (int i = 0; i < NN_HIDDEN; i++)
+		acc->values[i] = (int16_t)(acc->values[i] - weights[i]);
+}
+
+extern void nn_refresh(const nn_t *nn, const bitboard_t *bb, piece_color_t turn, nn_accumulator_t *acc) {
+	memcpy(acc->values, nn->accumulator_biases, sizeof(acc->values));
+	for (int color = 0; color < 2; color++) {
+		for (uint32_t rest = bb->color[color]; rest; rest &= rest - 1) {
+			int square = bb_first(rest);
+			add_feature(nn, acc, nn_feature(color, (bb->kings >> square) & 1, square));
+		}
+	}
+	if (turn == PIECE_WHITE)
+		add_feature(nn, acc, NN_TURN_FEATURE);
+}
+
+extern void nn_update(const nn_t *nn, const nn_accumulator_t *before, const bitboard_t *bb, const bb_move_t *move, nn_accumulator_t *after) {
+	int from = move->path[0];
+	int to = move->path[move->length];
+	piece_color_t color = ((bb->color[PIECE_WHITE] >> from) & 1) ? PIECE_WHITE : PIECE_BLACK;
+	int king = (bb->kings >> from) & 1;
+
+	*after = *before;
+	sub_feature(nn, after, nn_feature(color, king, from));
+	add_feature(nn, after, nn_feature(color, king | move->crown, to));
+	piece_color_t opponent = bb_other(color);
+	for (uint32_t rest = move->captures; rest; rest &= rest - 1) {
+		int square = bb_first(rest);
+		sub_feature(nn, after, nn_feature(opponent, (bb->kings >> square) & 1, square));
+	}
+	// the turn passes to the opponent
+	if (opponent == PIECE_WHITE)
+		add_feature(nn, after, NN_TURN_FEATURE);
+	else
+		sub_feature(nn, after, NN_TURN_FEATURE);
+}
+
+extern int nn_evaluate(const nn_t *nn, const nn_accumulator_t *acc) {
+	uint8_t hidden[NN_HIDDEN];
+	for (int i = 0; i < NN_HIDDEN; i++)
+		hidden[i] = (uint8_t)CLIP(acc->values[i]);
+
+	int32_t sums[NN_LAYER];
+	uint8_t layer1[NN_LAYER], layer2[NN_LAYER];
+	layer(nn->kernel, hidden, NN_HIDDEN, nn->layer1_weights[0], nn->layer1_biases, NN_LAYER, sums);
+	for (int i = 0; i < NN_LAYER; i++)
+		layer1[i] = (uint8_t)CLIP(sums[i] >> NN_WEIGHT_SHIFT);
+	layer(nn->kernel, layer1, NN_LAYER, nn->layer2_weights[0], nn->layer2_biases, NN_LAYER, sums);
+	for (int i = 0; i < NN_LAYER; i++)
+		layer2[i] = (uint8_t)CLIP(sums[i] >> NN_WEIGHT_SHIFT);
+
+	int32_t output;
+	layer(nn->kernel, layer2, NN_LAYER, nn->output_weights, &nn->output_bias, 1, &output);
+	return output / (1 << NN_OUTPUT_SHIFT);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "bitboard.h"
+
+#if RULES_BOARD_SIZE != 8
+	#error "the network has an input for each of the 32 squares of the 8x8 board"
+#endif
+
+/*
+ * A small quantized neural network evaluating positions on the CPU, used by
+ * the search in place of eval.h when a weights file is loaded:
+ *
+ *   input        one feature per [color][king][square] of each piece, and
+ *                one more when white is to move
+ *   accumulator  NN_HIDDEN int16 sums of the weights of the input features,
+ *                updated by each move like the zobrist hash: only the
+ *                features of the squares the move touches are added or
+ *                subtracted
+ *   layers       the accumulator clipped to 0..127, then two int8 layers of
+ *                NN_LAYER neurons, each scaled down by NN_WEIGHT_SHIFT and
+ *                clipped to 0..127, and an int8 output neuron
+ *
+ * The output is from black's point of view, in 1 / (1 << NN_OUTPUT_SHIFT)
+ * of the units of eval.h. The int8 layers run with AVX2 or SSSE3 when the
+ * CPU has it, the kernel is picked once at run time.
+ *
+ * File layout: a 16 byte header ("NCNN", the version, then NN_INPUTS,
+ * NN_HIDDEN and NN_LAYER in 2 bytes each from offset 8), then the weights
+ * and biases of each layer, all little endian:
+ *
+ *   int16 [NN_INPUTS][NN_HIDDEN]   accumulator weights
+ *   int16 [NN_HIDDEN]              accumulator biases
+ *   int8  [NN_LAYER][NN_HIDDEN]    first layer weights, int32 [NN_LAYER] biases
+ *   int8  [NN_LAYER][NN_LAYER]     second layer weights, int32 [NN_LAYER] biases
+ *   int8  [NN_LAYER]               output weights, int32 bias
+ *
+ * The trainer keeps the sums of the accumulator within int16.
+ */
+
+#define NN_INPUTS (2 * 2 * 32 + 1)
+#define NN_HIDDEN 128
+#define NN_LAYER 32
+#define NN_WEIGHT_SHIFT 6
+#define NN_OUTPUT_SHIFT 4
+
+#define NN_TURN_FEATURE (NN_INPUTS - 1)
+
+static inline int nn_feature(piece_color_t color, int king, int square) {
+	return (color * 2 + king) * 32 + square;
+}
+
+typedef enum { NN_KERNEL_SCALAR, NN_KERNEL_SSSE3, NN_KERNEL_AVX2 } nn_kernel_t;
+
+nn_kernel_t nn_best_kernel(void); // the best kernel this CPU can run
+const char *nn_kernel_name(nn_kernel_t kernel);
+
+typedef struct {
+	int16_t values[NN_HIDDEN];
+} nn_accumulator_t;
+
+// Weights loaded from a file, shared read-only by any number of threads
+typedef struct _nn nn_t;
+
+nn_t *nn_open(const char *path); // 0 when the file is missing or not a network
+void nn_close(nn_t *nn);
+nn_kernel_t nn_kernel(const nn_t *nn);
+// Changes the kernel of the int8 layers, which must be supported by the CPU
+void nn_set_kernel(nn_t *nn, nn_kernel_t kernel);
+
+void nn_refresh(const nn_t *nn, const bitboard_t *bb, piece_color_t turn, nn_accumulator_t *acc);
+// Sets `after` to the accumulator of the position after the move, from the
+// one of `bb`
+void nn_update(const nn_t *nn, const nn_accumulator_t *before, const bitboard_t *bb, const bb_move_t *move, nn_accumulator_t *after);
+int nn_evaluate(const nn_t *nn, const nn_accumulator_t *acc);
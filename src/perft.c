@@ -0,0 +1,194 @@
+/*
+ * Counts the leaf nodes of the game tree to a given depth, where a node is a
+ * complete turn. The count is done by both move generators so they can be
+ * checked against each other and timed:
+ *
+ *   find_local_moves   - hop by hop through find_valid_moves/perform_move,
+ *                        on the grid when built with -DGRID_RULES
+ *   perform_turn       - whole turns on a copy of the game state
+ *   make_move          - whole turns on a single game state, taken back
+ *                        with unmake_move
+ *   bb_generate_moves  - whole turns on the bitboard, with bulk counting
+ *
+ * Output is one tab separated line per generator and depth.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "game.h"
+#include "timer.h"
+
+#ifdef GRID_RULES
+	#define HOPS_GENERATOR "find_local_moves(grid)"
+#else
+	#define HOPS_GENERATOR "find_local_moves(bitboard)"
+#endif
+
+static uint64_t perft_hops(const game_state_t *game, int depth);
+
+// Chains of one turn already counted. With RULES_MAXIMUM_CAPTURE the same
+// pieces taken in another order ending on the same square are the same move.
+typedef struct {
+	int count;
+	struct {
+		int from, to;
+		bb_bits_t captures;
+	} chains[BB_MAX_MOVES];
+} ended_chains_t;
+
+#if RULES_MAXIMUM_CAPTURE
+
+static bool chain_seen(ended_chains_t *ended, int from, int to, bb_bits_t captures) {
+	for (int i = 0; i < ended->count; i++) {
+		if (ended->chains[i].from == from && ended->chains[i].to == to && ended->chains[i].captures == captures)
+			return true;
+	}
+	assert(ended->count < BB_MAX_MOVES);
+	ended->chains[ended->count].from = from;
+	ended->chains[ended->count].to = to;
+	ended->chains[ended->count++].captures = captures;
+	return false;
+}
+#endif
+
+// Follow the hops of a capture chain started at `from` until the turn ends
+static uint64_t perft_hops_from(const game_state_t *game, cell_pos_t from, cell_pos_t pos, int depth, ended_chains_t *ended) {
+	uint64_t result = 0;
+	piece_moves_t moves = find_valid_moves(game, pos);
+	for (int i = 0; i < moves.count; i++) {
+		game_state_t next = *game;
+		move_result_t res = perform_move(&next, pos, moves.moves[i].pos, 0);
+		if (res == MOVE_END_TURN) {
+#if RULES_MAXIMUM_CAPTURE
+			int capture = moves.moves[i].capture;
+			bb_bits_t captures = game->chain_captures | ((capture >= 0) ? BB_BIT(bb_square(game->pieces[capture].pos)) : 0);
+			if (captures && chain_seen(ended, bb_square(from), bb_square(moves.moves[i].pos), captures))
+				continue;
+#endif
+			result += perft_hops(&next, depth - 1);
+		} else if (res == MOVE_CONTINUE_TURN) {
+			result += perft_hops_from(&next, from, moves.moves[i].pos, depth, ended);
+		}
+	}
+	return result;
+}
+
+static uint64_t perft_hops(const game_state_t *game, int depth) {
+	if (depth == 0)
+		return 1;
+	uint64_t result = 0;
+	ended_chains_t ended = {0};
+	if (!game->game_over) {
+		for (int i = 0; i < ARRAY_SIZE(game->pieces); i++) {
+			const piece_t *piece = game->pieces + i;
+			if (!piece->captured && piece->color == game->current_turn)
+				result += perft_hops_from(game, piece->pos, piece->pos, depth, &ended);
+		}
+	}
+	return result;
+}
+
+static uint64_t perft_copy(const game_state_t *game, int depth) {
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = find_turn_moves(game, moves);
+	if (depth == 1)
+		return count;
+	uint64_t result = 0;
+	for (int i = 0; i < count; i++) {
+		game_state_t next = *game;
+		perform_turn(&next, moves + i);
+		result += perft_copy(&next, depth - 1);
+	}
+	return result;
+}
+
+static uint64_t perft_make(game_state_t *game, int depth) {
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = find_turn_moves(game, moves);
+	if (depth == 1)
+		return count;
+	uint64_t result = 0;
+	for (int i = 0; i < count; i++) {
+		undo_t undo;
+		make_move(game, moves + i, &undo);
+		result += perft_make(game, depth - 1);
+		unmake_move(game, &undo);
+	}
+	return result;
+}
+
+static uint64_t perft_bitboard(const bitboard_t *bb, piece_color_t turn, int depth) {
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = bb_generate_moves(bb, turn, moves);
+	if (depth == 1)
+		return count;
+	uint64_t result = 0;
+	for (int i = 0; i < count; i++) {
+		bitboard_t next = *bb;
+		bb_apply_move(&next, moves + i);
+		result += perft_bitboard(&next, bb_other(turn), depth - 1);
+	}
+	return result;
+}
+
+static void report(const char *generator, int depth, uint64_t nodes, double seconds) {
+	double nps = (seconds > 0) ? nodes / seconds : 0;
+	printf("%s\t%d\t%" PRIu64 "\t%.6f\t%.0f\n", generator, depth, nodes, seconds, nps);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2 || argc > 3 || atoi(argv[1]) < 1) {
+		fprintf(stderr,
+			"Usage:\n"
+			"    %s DEPTH [FEN]\n"
+			"\n"
+			"FEN is \"<turn>:W<squares>:B<squares>\", squares numbered 1 to %d from\n"
+			"the white side with K marking kings, e.g. \"B:W1,2,K18:B21,K30\".\n"
+			"Built with the %s rules.\n",
+			argv[0], BB_SQUARES, RULES_NAME
+		);
+		return 1;
+	}
+
+	int max_depth = atoi(argv[1]);
+	game_state_t game;
+	if (argc == 3) {
+		if (!game_load_fen(&game, argv[2])) {
+			fprintf(stderr, "ERROR invalid FEN: %s\n", argv[2]);
+			return 1;
+		}
+	} else {
+		game_init(&game);
+	}
+
+	int return_status = 0;
+	printf("generator\tdepth\tnodes\tseconds\tnodes_per_sec\n");
+	for (int depth = 1; depth <= max_depth; depth++) {
+		double start = timer_seconds();
+		uint64_t hops_nodes = perft_hops(&game, depth);
+		report(HOPS_GENERATOR, depth, hops_nodes, timer_seconds() - start);
+
+		start = timer_seconds();
+		uint64_t copy_nodes = perft_copy(&game, depth);
+		report("perform_turn", depth, copy_nodes, timer_seconds() - start);
+
+		start = timer_seconds();
+		uint64_t make_nodes = perft_make(&game, depth);
+		report("make_move", depth, make_nodes, timer_seconds() - start);
+
+		start = timer_seconds();
+		uint64_t bb_nodes = game.game_over ? 0 : perft_bitboard(&game.bitboard, game.current_turn, depth);
+		report("bb_generate_moves", depth, bb_nodes, timer_seconds() - start);
+
+		if (hops_nodes != bb_nodes || copy_nodes != bb_nodes || make_nodes != bb_nodes) {
+			fprintf(stderr, "ERROR node count mismatch at depth %d\n", depth);
+			return_status = 1;
+		}
+	}
+	return return_status;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+/*
+ * The rules variant is picked when compiling, with -DRULES_BRAZILIAN or
+ * -DRULES_INTERNATIONAL, and is the U.S. one otherwise. Each rule is a
+ * constant the move generator is specialized on, so no variant is tested
+ * while generating moves:
+ *
+ *   RULES_BOARD_SIZE            8, or 10 with 64 bit bitboards
+ *   RULES_MEN_ROWS              rows of men of each side at the start
+ *   RULES_FLYING_KINGS          kings move and capture along a whole diagonal,
+ *                               landing on any empty square past the capture
+ *   RULES_MEN_CAPTURE_BACKWARD  men capture backwards too, they still only
+ *                               step forward
+ *   RULES_CROWN_IN_CHAIN        a man reaching the far row in the middle of a
+ *                               capture chain is crowned and goes on as a
+ *                               king, otherwise it is only crowned when the
+ *                               chain ends there
+ *   RULES_CAPTURED_STAY         captured pieces are only taken off when the
+ *                               chain ends: until then they block the way and
+ *                               can't be jumped again
+ *   RULES_MAXIMUM_CAPTURE       of the capture chains, only the ones taking
+ *                               the most pieces can be played, kings counting
+ *                               as much as men
+ */
+
+#if defined(RULES_BRAZILIAN) && defined(RULES_INTERNATIONAL)
+	#error "only one rules variant can be picked"
+#endif
+
+#if defined(RULES_BRAZILIAN)
+	#define RULES_NAME "brazilian"
+	#define RULES_AMERICAN 0
+	#define RULES_BOARD_SIZE 8
+	#define RULES_MEN_ROWS 3
+	#define RULES_FLYING_KINGS 1
+	#define RULES_MEN_CAPTURE_BACKWARD 1
+	#define RULES_CROWN_IN_CHAIN 0
+	#define RULES_CAPTURED_STAY 1
+	#define RULES_MAXIMUM_CAPTURE 1
+#elif defined(RULES_INTERNATIONAL)
+	#define RULES_NAME "international"
+	#define RULES_AMERICAN 0
+	#define RULES_BOARD_SIZE 10
+	#define RULES_MEN_ROWS 4
+	#define RULES_FLYING_KINGS 1
+	#define RULES_MEN_CAPTURE_BACKWARD 1
+	#define RULES_CROWN_IN_CHAIN 0
+	#define RULES_CAPTURED_STAY 1
+	#define RULES_MAXIMUM_CAPTURE 1
+#else
+	#define RULES_NAME "american"
+	#define RULES_AMERICAN 1
+	#define RULES_BOARD_SIZE 8
+	#define RULES_MEN_ROWS 3
+	#define RULES_FLYING_KINGS 0
+	#define RULES_MEN_CAPTURE_BACKWARD 0
+	#define RULES_CROWN_IN_CHAIN 1
+	#define RULES_CAPTURED_STAY 0
+	#define RULES_MAXIMUM_CAPTURE 0
+#endif
+
+// The longest chains are found by the square a chain is on and the pieces it
+// took, which only tell the rest of the board when those pieces stay on it
+// and the piece doesn't change on the way
+#if RULES_MAXIMUM_CAPTURE && (RULES_CROWN_IN_CHAIN || !RULES_CAPTURED_STAY)
+	#error "the maximum capture rule needs RULES_CAPTURED_STAY and no RULES_CROWN_IN_CHAIN"
+#endif
+
+#define RULES_PIECES (RULES_MEN_ROWS * RULES_BOARD_SIZE / 2) // of each side
@@ -0,0 +1,539 @@
+/*
+ * Negamax alpha-beta search over whole turns. Every iteration of the root goes
+ * one turn deeper, so when the time runs out the best move of the last
+ * complete iteration is still available.
+ *
+ * With a game clock the time manager aims at a share of the clock plus most
+ * of the increment for each move. An iteration isn't started when it would
+ * likely end past that target, and the search is aborted at a hard limit
+ * that always leaves time on the clock.
+ *
+ * With more than one thread the search is a lazy SMP: helper threads search
+ * the same root at staggered depths and in a different move order, and only
+ * share work through the transposition table. The result is the one of the
+ * main thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eval.h"
+#include "search.h"
+#include "thread.h"
+#include "timer.h"
+#include "zobrist.h"
+
+#define MAX_THREADS 256
+
+// Move ordering scores, each heuristic above all the ones after it
+#define ORDER_HASH_MOVE (1 << 30)
+#define ORDER_CAPTURES (1 << 29)
+#define ORDER_KILLER (1 << 28)
+#define HISTORY_LIMIT (1 << 20) // halved past it, so it stays below the killers
+
+// Bits of a square in killer_key, which has to fit both squares and a flag
+#if BB_SQUARES > 32
+	#define KILLER_SQUARE_BITS 6
+#else
+	#define KILLER_SQUARE_BITS 5
+#endif
+
+#define MOVES_TO_GO 25 // moves the clock is assumed to have to last for
+#define CLOCK_RESERVE 0.05 // seconds never used, for sending the move
+#define MIN_THINK_TIME 0.01
+
+#define NN_EVAL_LIMIT (SCORE_TB_WIN / 2) // network scores stay clear of the won ones
+
+typedef struct _search_thread search_thread_t;
+
+typedef struct {
+	bitboard_t bb;
+	piece_color_t turn;
+	uint64_t hash;
+	int eval;
+	search_limits_t limits;
+	tt_t *tt;
+	tablebase_t *tb; // 0 without tablebases
+	int tb_pieces; // most pieces in a position the tablebases hold
+	double start_time; // of the clock, reset when pondering ends
+	bool pondering; // only read and written by the main thread
+	double target_time; // seconds from the start, 0 for no target
+	double hard_time; // seconds from the start the search is aborted at, 0 for no limit
+	volatile int stop;
+	search_thread_t *threads;
+	int thread_count;
+} search_shared_t;
+
+struct _search_thread {
+	search_shared_t *shared;
+	int id;
+	uint64_t nodes;
+	search_stats_t stats; // of the iteration being searched
+	uint16_t killers[SEARCH_MAX_PLY][2]; // killer_key of the last two steps that caused a cutoff
+	int history[2][BB_SQUARES][BB_SQUARES]; // [turn][from][to], depth squared for each cutoff
+	nn_accumulator_t accumulators[SEARCH_MAX_PLY + 1]; // by ply, with a network
+	search_result_t result;
+};
+
+// Shares the clock out between the moves still to play
+extern search_time_t search_move_time(const search_limits_t *limits) {
+	search_time_t result = { 0, limits->time_limit };
+	if (limits->clock > 0) {
+		// the increment is only added after the move, the hard limit comes
+		// from the clock alone
+		double available = limits->clock - CLOCK_RESERVE;
+		double target = limits->clock / MOVES_TO_GO + limits->increment * 0.75;
+		double hard = target * 4;
+		if (hard > available / 2)
+			hard = available / 2;
+		if (hard < MIN_THINK_TIME)
+			hard = MIN_THINK_TIME;
+		if (target > hard)
+			target = hard;
+		if (result.hard == 0 || hard < result.hard)
+			result.hard = hard;
+		result.target = (target < result.hard) ? target : result.hard;
+	}
+	return result;
+}
+
+static bool must_stop(search_thread_t *thread) {
+	search_shared_t *shared = thread->shared;
+	search_control_t *control = shared->limits.control;
+	if (thread->id == 0 && (thread->nodes & 1023) == 0) {
+		if (control && thread_atomic_get(&control->stop))
+			thread_atomic_set(&shared->stop, 1);
+		if (shared->pondering && !thread_atomic_get(&control->pondering)) {
+			// the expected move was played, the search goes on as if it had
+			// started now
+			shared->pondering = false;
+			shared->start_time = timer_seconds();
+		}
+		if (!shared->pondering && shared->hard_time > 0 && timer_seconds() - shared->start_time >= shared->hard_time)
+			thread_atomic_set(&shared->stop, 1);
+	}
+	if (thread->id == 0 && shared->limits.nodes > 0 && thread->nodes >= shared->limits.nodes)
+		thread_atomic_set(&shared->stop, 1);
+	return thread_atomic_get(&shared->stop) != 0;
+}
+
+// Scores of won or lost games, by the rules or by the tablebases, are stored
+// relative to the node, not the root
+static int score_to_tt(int score, int ply) {
+	if (score > SCORE_TB_WIN - SEARCH_MAX_PLY)
+		return score + ply;
+	if (score < -SCORE_TB_WIN + SEARCH_MAX_PLY)
+		return score - ply;
+	return score;
+}
+
+static int score_from_tt(int score, int ply) {
+	if (score > SCORE_TB_WIN - SEARCH_MAX_PLY)
+		return score - ply;
+	if (score < -SCORE_TB_WIN + SEARCH_MAX_PLY)
+		return score + ply;
+	return score;
+}
+
+// Killers are only steps, a capture is always searched before them
+static uint16_t killer_key(const bb_move_t *move) {
+	return (uint16_t)(1 << (2 * KILLER_SQUARE_BITS) | move->path[0] << KILLER_SQUARE_BITS | move->path[1]);
+}
+
+static bool enabled(const search_thread_t *thread, search_heuristic_t heuristic) {
+	return !(thread->shared->limits.disabled & (1u << heuristic));
+}
+
+static void score_moves(const search_thread_t *thread, const bitboard_t *bb, piece_color_t turn, const bb_move_t *moves, int count, int hash_move, int ply, int scores[]) {
+	const uint16_t *killers = thread->killers[ply];
+	for (int i = 0; i < count; i++) {
+		const bb_move_t *move = moves + i;
+		int score = 0;
+		if (i == hash_move && enabled(thread, SEARCH_HASH_MOVE))
+			score = ORDER_HASH_MOVE;
+		else if (move->captures && enabled(thread, SEARCH_CAPTURES))
+			score = ORDER_CAPTURES + 4 * bb_count(move->captures) + 2 * bb_count(move->captures & bb->kings) + move->crown;
+		else if (!move->captures && enabled(thread, SEARCH_KILLERS) && (killer_key(move) == killers[0] || killer_key(move) == killers[1]))
+			score = ORDER_KILLER + (killer_key(move) == killers[0]);
+		else if (enabled(thread, SEARCH_HISTORY))
+			score = thread->history[turn][move->path[0]][move->path[move->length]];
+		scores[i] = score;
+	}
+}
+
+static search_heuristic_t ordered_by(int score) {
+	if (score >= ORDER_HASH_MOVE)
+		return SEARCH_HASH_MOVE;
+	if (score >= ORDER_CAPTURES)
+		return SEARCH_CAPTURES;
+	if (score >= ORDER_KILLER)
+		return SEARCH_KILLERS;
+	return SEARCH_HISTORY;
+}
+
+// Brings the best scored of the moves not searched yet to order[n], the
+// rest of the list is only sorted as far as the search gets
+static int next_move(const int scores[], uint8_t order[], int n, int count) {
+	int best = n;
+	for (int i = n + 1; i < count; i++) {
+		if (scores[order[i]] > scores[order[best]])
+			best = i;
+	}
+	uint8_t swap = order[n];
+	order[n] = order[best];
+	order[best] = swap;
+	return order[n];
+}
+
+// Counts the cutoff, and remembers the step that caused it for the killers
+// and the history
+static void record_cutoff(search_thread_t *thread, piece_color_t turn, const bb_move_t *move, int score, int n, int depth, int ply) {
+	search_stats_t *stats = &thread->stats;
+	stats->cutoffs++;
+	if (n == 0)
+		stats->first_cutoffs++;
+	stats->heuristic_cutoffs[ordered_by(score)]++;
+	if (move->captures)
+		return;
+
+	uint16_t *killers = thread->killers[ply];
+	uint16_t key = killer_key(move);
+	if (killers[0] != key) {
+		killers[1] = killers[0];
+		killers[0] = key;
+	}
+	int (*history)[BB_SQUARES] = thread->history[turn];
+	history[move->path[0]][move->path[1]] += depth * depth;
+	if (history[move->path[0]][move->path[1]] > HISTORY_LIMIT) {
+		for (int from = 0; from < BB_SQUARES; from++) {
+			for (int to = 0; to < BB_SQUARES; to++)
+				history[from][to] /= 2;
+		}
+	}
+}
+
+// The evaluation of the network from the accumulator of the ply, from black's
+// point of view like eval
+static int network_eval(search_thread_t *thread, int ply) {
+	int eval = nn_evaluate(thread->shared->limits.nn, thread->accumulators + ply);
+	return (eval > NN_EVAL_LIMIT) ? NN_EVAL_LIMIT : (eval < -NN_EVAL_LIMIT) ? -NN_EVAL_LIMIT : eval;
+}
+
+// Captures are forced, so once the depth is over the search goes on while the
+// side to move has a capture and the static evaluation is only used on quiet
+// positions. The evaluation is passed down with the hash, updated by each move,
+// and so is the accumulator of the network when there is one.
+static int negamax(search_thread_t *thread, const bitboard_t *bb, piece_color_t turn, uint64_t hash, int eval, int depth, int ply, int alpha, int beta) {
+	thread->nodes++;
+	if (must_stop(thread))
+		return 0;
+
+	search_shared_t *shared = thread->shared;
+	if (shared->tb && bb_count(bb->color[PIECE_BLACK] | bb->color[PIECE_WHITE]) <= shared->tb_pieces) {
+		tb_wdl_t wdl;
+		if (tb_probe(shared->tb, bb, turn, &wdl)) {
+			if (wdl == TB_RESULT_WIN)
+				return SCORE_TB_WIN - ply;
+			if (wdl == TB_RESULT_LOSS)
+				return -SCORE_TB_WIN + ply;
+			return 0;
+		}
+	}
+
+	tt_t *tt = shared->tt;
+	int hash_move = -1;
+	tt_data_t entry;
+	if (tt && tt_probe(tt, hash, &entry)) {
+		if (entry.depth >= depth) {
+			int score = score_from_tt(entry.score, ply);
+			if (entry.bound == TT_EXACT ||
+				(entry.bound == TT_LOWER && score >= beta) ||
+				(entry.bound == TT_UPPER && score <= alpha))
+				return score;
+		}
+		if (entry.move != TT_NO_MOVE)
+			hash_move = entry.move;
+	}
+
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = bb_generate_moves(bb, turn, moves);
+	if (count == 0)
+		return -SCORE_WIN + ply;
+	if ((depth <= 0 && !moves[0].captures) || ply >= SEARCH_MAX_PLY)
+		return eval_for(shared->limits.nn ? network_eval(thread, ply) : eval, turn);
+	if (hash_move >= count)
+		hash_move = -1;
+
+	int scores[BB_MAX_MOVES];
+	uint8_t order[BB_MAX_MOVES];
+	score_moves(thread, bb, turn, moves, count, hash_move, ply, scores);
+	for (int i = 0; i < count; i++)
+		order[i] = (uint8_t)i;
+
+	int original_alpha = alpha;
+	int best = -SCORE_INFINITE;
+	int best_move = 0;
+	for (int n = 0; n < count; n++) {
+		int i = next_move(scores, order, n, count);
+		bitboard_t next = *bb;
+		uint64_t next_hash = hash ^ zobrist_move(bb, moves + i);
+		if (tt)
+			tt_prefetch(tt, next_hash);
+		int next_eval = eval + eval_move(bb, moves + i);
+		if (shared->limits.nn)
+			nn_update(shared->limits.nn, thread->accumulators + ply, bb, moves + i, thread->accumulators + ply + 1);
+		bb_apply_move(&next, moves + i);
+		int score = -negamax(thread, &next, bb_other(turn), next_hash, next_eval, depth - 1, ply + 1, -beta, -alpha);
+		if (thread_atomic_get(&shared->stop))
+			return 0;
+		if (score > best) {
+			best = score;
+			best_move = i;
+			if (score > alpha) {
+				alpha = score;
+				if (alpha >= beta) {
+					record_cutoff(thread, turn, moves + i, scores[i], n, depth, ply);
+					break;
+				}
+			}
+		}
+	}
+
+	if (tt) {
+		tt_data_t data;
+		data.score = (int16_t)score_to_tt(best, ply);
+		data.depth = (int8_t)(depth > 0 ? depth : 0);
+		data.bound = (best <= original_alpha) ? TT_UPPER : (best >= beta) ? TT_LOWER : TT_EXACT;
+		data.move = (uint8_t)best_move;
+		tt_store(tt, hash, data);
+	}
+	return best;
+}
+
+// Follows the best moves stored in the table from the position after each
+// root move of the lines, the reply to the best move is also the move to
+// ponder on
+static void fill_pvs(search_result_t *result, const bitboard_t *bb, piece_color_t turn, tt_t *tt) {
+	for (int n = 0; n < result->line_count; n++) {
+		search_line_t *line = result->lines + n;
+		bitboard_t position = *bb;
+		piece_color_t side = turn;
+		line->pv_length = 1;
+		while (tt && line->pv_length < SEARCH_MAX_PV) {
+			bb_apply_move(&position, line->pv + line->pv_length - 1);
+			side = bb_other(side);
+			tt_data_t entry;
+			if (!tt_probe(tt, zobrist_hash(&position, side), &entry) || entry.move == TT_NO_MOVE)
+				break;
+			bb_move_t moves[BB_MAX_MOVES];
+			if (entry.move >= bb_generate_moves(&position, side, moves))
+				break;
+			line->pv[line->pv_length++] = moves[entry.move];
+		}
+	}
+	result->ponder_found = result->lines[0].pv_length > 1;
+	if (result->ponder_found)
+		result->ponder_move = result->lines[0].pv[1];
+}
+
+static void report_progress(search_thread_t *thread) {
+	search_shared_t *shared = thread->shared;
+	search_result_t progress = thread->result;
+	progress.found = true;
+	progress.nodes = 0;
+	for (int i = 0; i < shared->thread_count; i++)
+		progress.nodes += shared->threads[i].nodes; // only a count for display, read without care
+	progress.seconds = timer_seconds() - shared->start_time;
+	fill_pvs(&progress, &shared->bb, shared->turn, shared->tt);
+	shared->limits.report(&progress, shared->limits.report_data);
+}
+
+static int search_thread_proc(void *data) {
+	search_thread_t *thread = data;
+	search_shared_t *shared = thread->shared;
+	const bitboard_t *bb = &shared->bb;
+	piece_color_t turn = shared->turn;
+
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = bb_generate_moves(bb, turn, moves);
+	if (shared->limits.nn)
+		nn_refresh(shared->limits.nn, bb, turn, thread->accumulators);
+
+	// helpers start at different depths and rotate the root moves so they
+	// don't all search the same tree in the same order
+	if (thread->id > 0 && count > 1) {
+		for (int r = 0; r < thread->id % count; r++) {
+			bb_move_t first = moves[0];
+			for (int i = 1; i < count; i++)
+				moves[i - 1] = moves[i];
+			moves[count - 1] = first;
+		}
+	}
+	int first_depth = 1 + (thread->id % 2);
+	int last_depth = (thread->id == 0) ? shared->limits.depth : SEARCH_MAX_PLY;
+	int lines = shared->limits.multipv;
+	if (lines < 1)
+		lines = 1;
+	if (lines > SEARCH_MAX_LINES)
+		lines = SEARCH_MAX_LINES;
+	if (lines > count)
+		lines = count;
+
+	for (int depth = first_depth; depth <= last_depth; depth++) {
+		uint64_t start_nodes = thread->nodes;
+		memset(&thread->stats, 0, sizeof(thread->stats));
+		// with more than one line the window only has to tell if a move
+		// beats the worst of the best lines so far, the best ones get exact
+		// scores
+		int scores[BB_MAX_MOVES];
+		int top[SEARCH_MAX_LINES]; // best scores so far, sorted
+		int best = 0;
+		for (int i = 0; i < count; i++) {
+			int alpha = (i < lines) ? -SCORE_INFINITE : top[lines - 1];
+			bitboard_t next = *bb;
+			uint64_t next_hash = shared->hash ^ zobrist_move(bb, moves + i);
+			int next_eval = shared->eval + eval_move(bb, moves + i);
+			if (shared->limits.nn)
+				nn_update(shared->limits.nn, thread->accumulators, bb, moves + i, thread->accumulators + 1);
+			bb_apply_move(&next, moves + i);
+			int score = -negamax(thread, &next, bb_other(turn), next_hash, next_eval, depth - 1, 1, -SCORE_INFINITE, -alpha);
+			if (thread_atomic_get(&shared->stop))
+				break;
+			scores[i] = score;
+			if (score > scores[best])
+				best = i;
+			if (i < lines || score > top[lines - 1]) {
+				int n = (i < lines) ? i : lines - 1;
+				for (; n > 0 && top[n - 1] < score; n--)
+					top[n] = top[n - 1];
+				top[n] = score;
+			}
+		}
+		if (thread_atomic_get(&shared->stop)) {
+			// moves[0] is the best of the last iteration, a move that beat it
+			// in this one was searched to the end and is the better move.
+			// Several lines are only replaced all together.
+			if (best > 0 && lines == 1) {
+				thread->result.best_move = moves[best];
+				thread->result.score = scores[best];
+				thread->result.lines[0].score = scores[best];
+				thread->result.lines[0].pv[0] = moves[best];
+			}
+			break;
+		}
+
+		// bring the lines to the front, best first, they are also searched
+		// first in the next iteration
+		for (int n = 0; n < lines; n++) {
+			int line_best = n;
+			for (int i = n + 1; i < count; i++) {
+				if (scores[i] > scores[line_best])
+					line_best = i;
+			}
+			bb_move_t swap_move = moves[n];
+			moves[n] = moves[line_best];
+			moves[line_best] = swap_move;
+			int swap_score = scores[n];
+			scores[n] = scores[line_best];
+			scores[line_best] = swap_score;
+			thread->result.lines[n].score = scores[n];
+			thread->result.lines[n].pv[0] = moves[n];
+			thread->result.lines[n].pv_length = 1;
+		}
+		thread->result.line_count = lines;
+		int alpha = scores[0];
+
+		thread->result.best_move = moves[0];
+		thread->result.score = alpha;
+		thread->result.depth = depth;
+		if (depth <= SEARCH_MAX_DEPTH) {
+			thread->result.iterations[depth] = thread->stats;
+			thread->result.iterations[depth].nodes = thread->nodes - start_nodes;
+			thread->result.iterations[depth].seconds = timer_seconds() - shared->start_time;
+		}
+		if (thread->id == 0 && shared->limits.report)
+			report_progress(thread);
+
+		// a forced win or loss won't change with more depth, though the
+		// other lines still might
+		if (lines == 1 && (alpha >= SCORE_WIN - SEARCH_MAX_PLY || alpha <= -SCORE_WIN + SEARCH_MAX_PLY))
+			break;
+
+		// an iteration takes about as long as all the ones before it, so the
+		// next one would likely end past the target
+		if (thread->id == 0 && shared->target_time > 0 && !shared->pondering) {
+			double elapsed = timer_seconds() - shared->start_time;
+			if (count == 1 || elapsed * 2 > shared->target_time)
+				break;
+		}
+	}
+
+	if (thread->id == 0)
+		thread_atomic_set(&shared->stop, 1);
+	return 0;
+}
+
+extern search_result_t search(const bitboard_t *bb, piece_color_t turn, const search_limits_t *limits, tt_t *tt, tablebase_t *tb) {
+	search_result_t result = {0};
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = bb_generate_moves(bb, turn, moves);
+	if (count == 0)
+		return result;
+
+	search_shared_t shared = {0};
+	shared.bb = *bb;
+	shared.turn = turn;
+	shared.hash = zobrist_hash(bb, turn);
+	shared.eval = eval_position(bb);
+	shared.limits = *limits;
+	shared.tt = tt;
+	shared.tb = tb;
+	shared.tb_pieces = tb ? tb_max_pieces(tb) : 0;
+	shared.start_time = timer_seconds();
+	shared.pondering = limits->control && thread_atomic_get(&limits->control->pondering);
+	search_time_t time = search_move_time(limits);
+	shared.target_time = time.target;
+	shared.hard_time = time.hard;
+
+	int thread_count = limits->threads;
+	if (thread_count < 1)
+		thread_count = 1;
+	else if (thread_count > MAX_THREADS)
+		thread_count = MAX_THREADS;
+
+	// too big for the stack with the killers and history of every thread
+	search_thread_t *threads = calloc(thread_count, sizeof(search_thread_t));
+	if (!threads)
+		return result;
+	shared.threads = threads;
+	shared.thread_count = thread_count;
+	thread_t *handles[MAX_THREADS] = {0};
+	for (int i = 0; i < thread_count; i++) {
+		threads[i].shared = &shared;
+		threads[i].id = i;
+		threads[i].result.best_move = moves[0];
+	}
+	for (int i = 1; i < thread_count; i++)
+		handles[i] = thread_create(search_thread_proc, threads + i);
+
+	search_thread_proc(threads);
+
+	for (int i = 1; i < thread_count; i++) {
+		if (handles[i])
+			thread_join(handles[i]);
+	}
+
+	result = threads[0].result;
+	result.found = true;
+	if (result.line_count == 0) { // stopped before the first iteration was over
+		result.line_count = 1;
+		result.lines[0].score = result.score;
+		result.lines[0].pv[0] = result.best_move;
+	}
+	fill_pvs(&result, bb, turn, tt);
+	for (int i = 0; i < thread_count; i++)
+		result.nodes += threads[i].nodes;
+	result.seconds = timer_seconds() - shared.start_time;
+	free(threads);
+	return result;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "bitboard.h"
+#include "nn.h"
+#include "tablebase.h"
+#include "tt.h"
+
+#define SCORE_INFINITE 32000
+#define SCORE_WIN 30000 // minus the distance in plies to the end of the game
+#define SCORE_TB_WIN 20000 // won according to the tablebases, minus the plies to get there
+
+#define SEARCH_MAX_PLY 128 // so a won score is always above SCORE_WIN - SEARCH_MAX_PLY
+#define SEARCH_MAX_DEPTH 64 // iterations with statistics
+#define SEARCH_MAX_PV 16
+#define SEARCH_MAX_LINES 16 // for MultiPV
+
+// What moves are searched first with, in this order
+typedef enum {
+	SEARCH_HASH_MOVE, // the best move stored in the transposition table
+	SEARCH_CAPTURES, // the chains that capture the most, kings counting more
+	SEARCH_KILLERS, // steps that caused a cutoff at the same ply before
+	SEARCH_HISTORY, // the other steps, by how often they caused cutoffs
+	SEARCH_HEURISTICS
+} search_heuristic_t;
+
+// Set from another thread while a search runs
+typedef struct {
+	volatile int stop; // ends the search, the last complete iteration is the result
+	volatile int pondering; // time limits are ignored until it is cleared, then the clock starts
+} search_control_t;
+
+typedef struct {
+	uint64_t nodes;
+	double seconds; // from the start of the search to the end of the iteration
+	uint64_t cutoffs; // nodes where a move scored at least beta
+	uint64_t first_cutoffs; // of those, with the first move searched
+	uint64_t heuristic_cutoffs[SEARCH_HEURISTICS]; // by the heuristic that ordered the move
+} search_stats_t;
+
+// A root move and what is expected to follow it
+typedef struct {
+	int score; // exact, from the point of view of the side to move
+	bb_move_t pv[SEARCH_MAX_PV]; // the root move first
+	int pv_length;
+} search_line_t;
+
+typedef struct {
+	bool found; // false if the side to move has no move
+	bb_move_t best_move;
+	bool ponder_found; // the transposition table holds a reply to the best move
+	bb_move_t ponder_move; // the reply expected, to search while the opponent thinks
+	search_line_t lines[SEARCH_MAX_LINES]; // best first, lines[0] starts with best_move
+	int line_count;
+	int score; // from the point of view of the side to move
+	int depth; // last depth searched to the end
+	uint64_t nodes;
+	double seconds;
+	search_stats_t iterations[SEARCH_MAX_DEPTH + 1]; // of the main thread, by depth
+} search_result_t;
+
+// Called by the main search thread after each iteration with the result so
+// far, nodes and seconds counted for all the threads
+typedef void (*search_report_t)(const search_result_t *progress, void *data);
+
+typedef struct {
+	int depth; // in turns
+	double time_limit; // seconds, 0 for no limit
+	int threads; // helper threads plus the calling one, they share the tt
+	unsigned disabled; // bits (1 << search_heuristic_t) of heuristics left out, to measure them
+	double clock; // seconds left on the clock of the side to move, 0 without a clock
+	double increment; // seconds added to the clock after the move
+	search_control_t *control; // 0 when nothing but the limits ends the search
+	uint64_t nodes; // searched by the main thread, 0 for no limit
+	int multipv; // best moves to score exactly, up to SEARCH_MAX_LINES, 0 or 1 for only the best
+	const nn_t *nn; // evaluates quiet positions instead of eval.h, 0 for the handcrafted evaluation
+	search_report_t report; // 0 for none
+	void *report_data;
+} search_limits_t;
+
+// Seconds the limits allow for a move: the target a search stops starting
+// new iterations at and the hard limit it is cut off at, 0 for none
+typedef struct {
+	double target;
+	double hard;
+} search_time_t;
+
+search_result_t search(const bitboard_t *bb, piece_color_t turn, const search_limits_t *limits, tt_t *tt, tablebase_t *tb);
+search_time_t search_move_time(const search_limits_t *limits);
@@ -0,0 +1,307 @@
+/*
+ * Plays engine against engine games, many at a time, and writes every
+ * searched position with its score and the result of its game, as training
+ * data for the network of nn.h. Each worker thread plays whole games on its
+ * own game state and transposition table, taking game numbers from a shared
+ * counter until all the games are played.
+ *
+ * Games start with OPENING_PLIES random moves picked from the game number,
+ * so every run plays the same games, and every move after those is searched
+ * to a fixed node count. A game is a draw after MAX_GAME_PLIES or on the
+ * third repetition of a position, and with tablebases it ends as soon as it
+ * reaches a position they hold.
+ *
+ * File layout: a 16 byte header ("NCSP" and the version), then one 16 byte
+ * record per position, all numbers little endian:
+ *
+ *   uint32  black pieces, white pieces and kings
+ *   int16   score of the search, from the point of view of the side to move
+ *   uint8   flags: 1 when white is to move, 2 when the side to move must capture
+ *   int8    result for the side to move: 1 won, 0 draw, -1 lost
+ *
+ * Each worker gathers the records of its games and writes them in batches.
+ * Output is one tab separated line on stdout, progress goes to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "search.h"
+#include "thread.h"
+#include "timer.h"
+
+#define DEFAULT_NODES 5000
+#define OPENING_PLIES 8
+#define MAX_GAME_PLIES 300
+#define TT_MEGABYTES 16 // per worker
+#define BATCH_RECORDS 16384 // written at once, per worker
+#define PROGRESS_GAMES 1000
+#define MAX_THREADS 256
+
+#define FILE_MAGIC "NCSP"
+#define FILE_VERSION 1
+#define HEADER_SIZE 16
+#define RECORD_SIZE 16
+
+#define FLAG_WHITE 1
+#define FLAG_CAPTURE 2
+
+typedef struct {
+	int games;
+	uint64_t nodes; // per move
+	tablebase_t *tb; // 0 without tablebases
+	const nn_t *nn; // 0 for the handcrafted evaluation
+	FILE *file;
+	volatile int file_lock;
+	bool write_failed; // only touched with the lock held
+	volatile int next_game;
+	volatile int finished;
+	double start_time;
+} selfplay_t;
+
+typedef struct {
+	selfplay_t *selfplay;
+	tt_t *tt;
+	uint8_t *batch;
+	int batch_count; // records
+	uint64_t positions;
+	int wins[2]; // by color
+	int draws;
+} worker_t;
+
+static uint64_t xorshift64(uint64_t *state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+static void write_le(uint8_t *p, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		p[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void flush_batch(worker_t *worker) {
+	selfplay_t *selfplay = worker->selfplay;
+	thread_spin_lock(&selfplay->file_lock);
+	if (fwrite(worker->batch, RECORD_SIZE, worker->batch_count, selfplay->file) != (size_t)worker->batch_count)
+		selfplay->write_failed = true;
+	thread_spin_unlock(&selfplay->file_lock);
+	worker->batch_count = 0;
+}
+
+// Times the position of the last ply was reached before with the same side
+// to move
+static int repetitions(const uint64_t *hashes, int ply) {
+	int result = 0;
+	for (int i = ply - 2; i >= 0; i -= 2)
+		result += hashes[i] == hashes[ply];
+	return result;
+}
+
+// Plays a game and leaves its records in `records`, returns how many. The
+// winner is PIECE_BLACK or PIECE_WHITE, or -1 for a draw.
+static int play_game(worker_t *worker, int number, uint8_t *records, int *winner) {
+	selfplay_t *selfplay = worker->selfplay;
+	search_limits_t limits = {0};
+	limits.depth = SEARCH_MAX_DEPTH;
+	limits.threads = 1;
+	limits.nodes = selfplay->nodes;
+	limits.nn = selfplay->nn;
+	int tb_pieces = selfplay->tb ? tb_max_pieces(selfplay->tb) : 0;
+
+	uint64_t seed = 0x9E3779B97F4A7C15ull * (uint64_t)(number + 1);
+	uint64_t hashes[MAX_GAME_PLIES + 1];
+	game_state_t game;
+	game_init(&game);
+	tt_clear(worker->tt); // the same game on every run
+	hashes[0] = game.hash;
+	*winner = -1;
+	int count = 0;
+	for (int ply = 0; ; ply++) {
+		piece_color_t turn = game.current_turn;
+		bb_move_t moves[BB_MAX_MOVES];
+		int move_count = find_turn_moves(&game, moves);
+		if (move_count == 0) {
+			*winner = bb_other(turn);
+			break;
+		}
+		if (ply == MAX_GAME_PLIES || repetitions(hashes, ply) >= 2)
+			break;
+		tb_wdl_t wdl;
+		if (tb_pieces && bb_count(game.bitboard.color[PIECE_BLACK] | game.bitboard.color[PIECE_WHITE]) <= tb_pieces
+			&& tb_probe(selfplay->tb, &game.bitboard, turn, &wdl)) {
+			if (wdl != TB_RESULT_DRAW)
+				*winner = (wdl == TB_RESULT_WIN) ? turn : bb_other(turn);
+			break;
+		}
+
+		bb_move_t move;
+		if (ply < OPENING_PLIES) {
+			move = moves[xorshift64(&seed) % move_count];
+		} else {
+			search_result_t result = search(&game.bitboard, turn, &limits, worker->tt, selfplay->tb);
+			move = result.best_move;
+			uint8_t *record = records + count++ * RECORD_SIZE;
+			write_le(record, game.bitboard.color[PIECE_BLACK], 4);
+			write_le(record + 4, game.bitboard.color[PIECE_WHITE], 4);
+			write_le(record + 8, game.bitboard.kings, 4);
+			write_le(record + 12, (uint16_t)(int16_t)result.score, 2);
+			record[14] = (uint8_t)((turn == PIECE_WHITE ? FLAG_WHITE : 0) | (moves[0].captures ? FLAG_CAPTURE : 0));
+		}
+		undo_t undo;
+		make_move(&game, &move, &undo);
+		hashes[ply + 1] = game.hash;
+	}
+
+	for (int i = 0; i < count; i++) {
+		uint8_t *record = records + i * RECORD_SIZE;
+		piece_color_t turn = (record[14] & FLAG_WHITE) ? PIECE_WHITE : PIECE_BLACK;
+		int result = (*winner < 0) ? 0 : (*winner == (int)turn) ? 1 : -1;
+		record[15] = (uint8_t)(int8_t)result;
+	}
+	return count;
+}
+
+static int worker_proc(void *data) {
+	worker_t *worker = data;
+	selfplay_t *selfplay = worker->selfplay;
+	uint8_t records[MAX_GAME_PLIES * RECORD_SIZE];
+	for (;;) {
+		int number = thread_atomic_add(&selfplay->next_game, 1);
+		if (number >= selfplay->games)
+			break;
+		int winner;
+		int count = play_game(worker, number, records, &winner);
+		if (worker->batch_count + count > BATCH_RECORDS)
+			flush_batch(worker);
+		memcpy(worker->batch + worker->batch_count * RECORD_SIZE, records, count * RECORD_SIZE);
+		worker->batch_count += count;
+		worker->positions += count;
+		if (winner < 0)
+			worker->draws++;
+		else
+			worker->wins[winner]++;
+
+		int finished = thread_atomic_add(&selfplay->finished, 1) + 1;
+		if (finished % PROGRESS_GAMES == 0)
+			fprintf(stderr, "%d games, %.0f seconds\n", finished, timer_seconds() - selfplay->start_time);
+	}
+	flush_batch(worker);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *program = argv[0];
+	const char *nn_path = 0, *tb_path = 0;
+	while (argc > 2 && (strcmp(argv[1], "-nn") == 0 || strcmp(argv[1], "-tb") == 0)) {
+		if (strcmp(argv[1], "-nn") == 0)
+			nn_path = argv[2];
+		else
+			tb_path = argv[2];
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 3 || argc > 5 || atoi(argv[2]) < 1 || (argc > 3 && atoi(argv[3]) < 1)) {
+		fprintf(stderr,
+			"Usage:\n"
+			"    %s [-nn FILE] [-tb DIRECTORY] OUTPUT GAMES [NODES [THREADS]]\n"
+			"\n"
+			"NODES are searched for each move and default to %d, THREADS defaults to\n"
+			"the number of cores. -nn evaluates with a network instead of the\n"
+			"handcrafted evaluation, -tb ends games on the tablebase positions.\n",
+			program, DEFAULT_NODES
+		);
+		return 1;
+	}
+
+	selfplay_t selfplay = {0};
+	selfplay.games = atoi(argv[2]);
+	selfplay.nodes = (argc > 3) ? strtoull(argv[3], 0, 10) : DEFAULT_NODES;
+	int thread_count = (argc > 4) ? atoi(argv[4]) : thread_cpu_count();
+	if (thread_count < 1)
+		thread_count = 1;
+	else if (thread_count > MAX_THREADS)
+		thread_count = MAX_THREADS;
+
+	nn_t *nn = 0;
+	if (nn_path) {
+		nn = nn_open(nn_path);
+		if (!nn) {
+			fprintf(stderr, "ERROR could not load the network: %s\n", nn_path);
+			return 1;
+		}
+		selfplay.nn = nn;
+	}
+	if (tb_path) {
+		selfplay.tb = tb_open(tb_path);
+		if (!selfplay.tb || tb_max_pieces(selfplay.tb) == 0) {
+			fprintf(stderr, "ERROR no tablebases in %s\n", tb_path);
+			return 1;
+		}
+	}
+
+	selfplay.file = fopen(argv[1], "wb");
+	if (!selfplay.file) {
+		perror(argv[1]);
+		return 1;
+	}
+	uint8_t header[HEADER_SIZE] = FILE_MAGIC;
+	header[4] = FILE_VERSION;
+	if (fwrite(header, sizeof(header), 1, selfplay.file) != 1)
+		selfplay.write_failed = true;
+
+	worker_t *workers = calloc(thread_count, sizeof(worker_t));
+	if (!workers) {
+		perror("ERROR calloc");
+		return 1;
+	}
+	for (int i = 0; i < thread_count; i++) {
+		workers[i].selfplay = &selfplay;
+		workers[i].tt = tt_create(TT_MEGABYTES);
+		workers[i].batch = malloc(BATCH_RECORDS * RECORD_SIZE);
+		if (!workers[i].tt || !workers[i].batch) {
+			fprintf(stderr, "ERROR could not allocate worker %d\n", i);
+			return 1;
+		}
+	}
+
+	selfplay.start_time = timer_seconds();
+	thread_t *handles[MAX_THREADS] = {0};
+	for (int i = 1; i < thread_count; i++)
+		handles[i] = thread_create(worker_proc, workers + i);
+	worker_proc(workers);
+	for (int i = 1; i < thread_count; i++) {
+		if (handles[i])
+			thread_join(handles[i]);
+	}
+	double seconds = timer_seconds() - selfplay.start_time;
+
+	if (fclose(selfplay.file) != 0 || selfplay.write_failed) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	uint64_t positions = 0;
+	int wins[2] = {0}, draws = 0;
+	for (int i = 0; i < thread_count; i++) {
+		positions += workers[i].positions;
+		wins[PIECE_BLACK] += workers[i].wins[PIECE_BLACK];
+		wins[PIECE_WHITE] += workers[i].wins[PIECE_WHITE];
+		draws += workers[i].draws;
+		tt_destroy(workers[i].tt);
+		free(workers[i].batch);
+	}
+	printf("games\tpositions\tblack_wins\twhite_wins\tdraws\tseconds\tpositions_per_hour\n");
+	printf("%d\t%llu\t%d\t%d\t%d\t%.3f\t%.0f\n", selfplay.games, (unsigned long long)positions,
+		wins[PIECE_BLACK], wins[PIECE_WHITE], draws, seconds, (seconds > 0) ? positions * 3600 / seconds : 0);
+
+	free(workers);
+	if (selfplay.tb)
+		tb_close(selfplay.tb);
+	if (nn)
+		nn_close(nn);
+	return 0;
+}
@@ -4,13 +4,29 @@ extern "C" {
 
 #include "network.h"
 
+// Settings of the AI opponent when the front end doesn't ask for others
+#define DEFAULT_AI_DEPTH 12
+#define DEFAULT_AI_TIME_LIMIT 2.0
+#define DEFAULT_AI_THREADS 1
+#define DEFAULT_AI_HASH_MB 64
+
 typedef struct {
 	bool success;
 	net_context_t *network;
 	net_mode_t net_mode;
+	bool ai_opponent; // play against the local engine instead of the network
+	int ai_depth;
+	double ai_time_limit; // seconds per move
+	double ai_clock; // seconds for the whole game, 0 to use ai_time_limit instead
+	double ai_increment; // seconds added to the clock after each move
+	int ai_threads;
+	int ai_hash_mb; // transposition table size
 	char host[1024];
 	char port[6];
 	char assets_path[1024];
+	char tablebase_path[1024]; // directory of the .wdl files, used if it exists
+	char book_path[1024]; // opening book file, used if it exists
+	char nn_path[1024]; // weights of the neural evaluation, used if the file exists
 } startup_info_t;
 
 startup_info_t startup(int argc, char **argv);
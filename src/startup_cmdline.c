@@ -1,25 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
 #include "startup.h"
 
-static startup_info_t startup(int argc, char **argv) {
+extern startup_info_t startup(int argc, char **argv) {
 	startup_info_t result = {0};
 	if (argc == 3 && strcmp(argv[1], "server") == 0) {
 		result.success = true;
-		result.server_mode = true;
-		strncpy(result.port, argv[2], sizeof(result.port));
+		result.net_mode = NET_SERVER;
+		strncpy(result.port, argv[2], sizeof(result.port) - 1);
 	} else if (argc == 4 && strcmp(argv[1], "client") == 0) {
 		result.success = true;
-		result.server_mode = false;
-		strncpy(result.host, argv[2], sizeof(result.host));
-		strncpy(result.port, argv[3], sizeof(result.port));
-	} else {
-		result.success = false;
+		result.net_mode = NET_CLIENT;
+		strncpy(result.host, argv[2], sizeof(result.host) - 1);
+		strncpy(result.port, argv[3], sizeof(result.port) - 1);
+	} else if (argc >= 2 && argc <= 6 && strcmp(argv[1], "ai") == 0) {
+		result.success = true;
+		result.ai_opponent = true;
+		result.ai_depth = (argc >= 3) ? atoi(argv[2]) : DEFAULT_AI_DEPTH;
+		result.ai_time_limit = DEFAULT_AI_TIME_LIMIT;
+		if (argc >= 4) {
+			// a game clock is written as its seconds and the increment
+			if (strchr(argv[3], '+')) {
+				if (sscanf(argv[3], "%lf+%lf", &result.ai_clock, &result.ai_increment) != 2 || result.ai_clock <= 0)
+					result.success = false;
+				result.ai_time_limit = 0;
+			} else {
+				result.ai_time_limit = atof(argv[3]);
+			}
+		}
+		result.ai_threads = (argc >= 5) ? atoi(argv[4]) : DEFAULT_AI_THREADS;
+		result.ai_hash_mb = (argc >= 6) ? atoi(argv[5]) : DEFAULT_AI_HASH_MB;
+		if (result.ai_depth < 1 || result.ai_threads < 1 || result.ai_hash_mb < 1)
+			result.success = false;
+	}
+
+	if (!result.success) {
 		fprintf(stderr,
 			"Usage:\n"
 			"    %s server PORT\n"
-			"    %s client HOST PORT\n",
-			argv[0], argv[0]
+			"    %s client HOST PORT\n"
+			"    %s ai [DEPTH [SECONDS [THREADS [HASH_MB]]]]\n"
+			"\n"
+			"SECONDS is the time for each move, or the computer's clock for the whole\n"
+			"game and the increment after each move, e.g. 300+2.\n",
+			argv[0], argv[0], argv[0]
 		);
+	} else if (!result.ai_opponent) {
+		result.network = net_init();
+		net_start(result.network, result.net_mode, result.host, result.port);
+		while (net_get_state(result.network) == NET_CONNECTING)
+			SDL_Delay(50);
+		if (net_get_state(result.network) != NET_RUNNING) {
+			fprintf(stderr, "ERROR network: %s\n", net_error_str(result.network));
+			net_destroy(result.network);
+			result.network = 0;
+			result.success = false;
+		}
 	}
 	strcpy(result.assets_path, "assets");
+	strcpy(result.tablebase_path, "tablebases");
+	strcpy(result.book_path, "opening.book");
+	strcpy(result.nn_path, "eval.nn");
 	return result;
 }
@@ -42,11 +42,23 @@ public:
 	}
 private slots:
 	void on_modeComboBox_currentIndexChanged(int index) {
-		bool disable = (index == 0);
+		bool disable = (index != 1);
 		ui->hostLineEdit->setDisabled(disable);
 		ui->hostLabel->setDisabled(disable);
+		ui->portSpinBox->setDisabled(index == 2);
+		ui->portLabel->setDisabled(index == 2);
 	}
 	void on_startButton_clicked() {
+		if (ui->modeComboBox->currentIndex() == 2) {
+			info->ai_opponent = true;
+			info->ai_depth = DEFAULT_AI_DEPTH;
+			info->ai_time_limit = DEFAULT_AI_TIME_LIMIT;
+			info->ai_threads = DEFAULT_AI_THREADS;
+			info->ai_hash_mb = DEFAULT_AI_HASH_MB;
+			info->success = true;
+			close();
+			return;
+		}
 		info->net_mode = (ui->modeComboBox->currentIndex() == 0) ? NET_SERVER : NET_CLIENT;
 		strncpy(info->host, ui->hostLineEdit->text().toUtf8().data(), sizeof(info->host));
 		snprintf(info->port, sizeof(info->port), "%d", ui->portSpinBox->value());
@@ -127,7 +139,14 @@ startup_info_t startup(int argc, char **argv) {
 		app.processEvents();
 	}
 
+	if (result.ai_opponent) {
+		net_destroy(result.network);
+		result.network = 0;
+	}
 	strcpy(result.assets_path, "assets");
+	strcpy(result.tablebase_path, "tablebases");
+	strcpy(result.book_path, "opening.book");
+	strcpy(result.nn_path, "eval.nn");
 
 	return result;
 }
@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tablebase.h"
+#include "file_map.h"
+#include "thread.h"
+
+/*
+ * The index of a position is built from four combination ranks, one for each
+ * kind of piece. Men never stand on the row where they would be crowned, so
+ * black men use squares 4-31 and white men squares 0-27. Overlapping pieces
+ * aren't excluded from the index, they just hold TB_INVALID.
+ */
+
+typedef struct {
+	int offset; // first square
+	int squares;
+} piece_range_t;
+
+static const piece_range_t black_men = { 4, 28 };
+static const piece_range_t white_men = { 0, 28 };
+static const piece_range_t kings = { 0, 32 };
+
+// binomials[n][k] = n! / (k! (n - k)!)
+static const uint32_t binomials[33][TB_MAX_PIECES + 1] = {
+	{ 1, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ 1, 1, 0, 0, 0, 0, 0, 0, 0 },
+	{ 1, 2, 1, 0, 0, 0, 0, 0, 0 },
+	{ 1, 3, 3, 1, 0, 0, 0, 0, 0 },
+	{ 1, 4, 6, 4, 1, 0, 0, 0, 0 },
+	{ 1, 5, 10, 10, 5, 1, 0, 0, 0 },
+	{ 1, 6, 15, 20, 15, 6, 1, 0, 0 },
+	{ 1, 7, 21, 35, 35, 21, 7, 1, 0 },
+	{ 1, 8, 28, 56, 70, 56, 28, 8, 1 },
+	{ 1, 9, 36, 84, 126, 126, 84, 36, 9 },
+	{ 1, 10, 45, 120, 210, 252, 210, 120, 45 },
+	{ 1, 11, 55, 165, 330, 462, 462, 330, 165 },
+	{ 1, 12, 66, 220, 495, 792, 924, 792, 495 },
+	{ 1, 13, 78, 286, 715, 1287, 1716, 1716, 1287 },
+	{ 1, 14, 91, 364, 1001, 2002, 3003, 3432, 3003 },
+	{ 1, 15, 105, 455, 1365, 3003, 5005, 6435, 6435 },
+	{ 1, 16, 120, 560, 1820, 4368, 8008, 11440, 12870 },
+	{ 1, 17, 136, 680, 2380, 6188, 12376, 19448, 24310 },
+	{ 1, 18, 153, 816, 3060, 8568, 18564, 31824, 43758 },
+	{ 1, 19, 171, 969, 3876, 11628, 27132, 50388, 75582 },
+	{ 1, 20, 190, 1140, 4845, 15504, 38760, 77520, 125970 },
+	{ 1, 21, 210, 1330, 5985, 20349, 54264, 116280, 203490 },
+	{ 1, 22, 231, 1540, 7315, 26334, 74613, 170544, 319770 },
+	{ 1, 23, 253, 1771, 8855, 33649, 100947, 245157, 490314 },
+	{ 1, 24, 276, 2024, 10626, 42504, 134596, 346104, 735471 },
+	{ 1, 25, 300, 2300, 12650, 53130, 177100, 480700, 1081575 },
+	{ 1, 26, 325, 2600, 14950, 65780, 230230, 657800, 1562275 },
+	{ 1, 27, 351, 2925, 17550, 80730, 296010, 888030, 2220075 },
+	{ 1, 28, 378, 3276, 20475, 98280, 376740, 1184040, 3108105 },
+	{ 1, 29, 406, 3654, 23751, 118755, 475020, 1560780, 4292145 },
+	{ 1, 30, 435, 4060, 27405, 142506, 593775, 2035800, 5852925 },
+	{ 1, 31, 465, 4495, 31465, 169911, 736281, 2629575, 7888725 },
+	{ 1, 32, 496, 4960, 35960, 201376, 906192, 3365856, 10518300 },
+};
+
+static uint64_t binomial(int n, int k) {
+	return (n < 0 || k < 0 || k > TB_MAX_PIECES) ? 0 : binomials[n][k];
+}
+
+// Colexicographic rank of the set bits of b inside the range
+static uint64_t rank(uint32_t b, piece_range_t range) {
+	uint64_t result = 0;
+	for (int i = 1; b; i++, b &= b - 1)
+		result += binomial(bb_first(b) - range.offset, i);
+	return result;
+}
+
+static uint32_t unrank(uint64_t index, int count, piece_range_t range) {
+	uint32_t result = 0;
+	int square = range.squares;
+	for (int i = count; i > 0; i--) {
+		do
+			square--;
+		while (binomial(square, i) > index);
+		index -= binomial(square, i);
+		result |= 1u << (square + range.offset);
+	}
+	return result;
+}
+
+static uint32_t reverse_bits(uint32_t b) {
+	b = ((b >> 1) & 0x55555555u) | ((b & 0x55555555u) << 1);
+	b = ((b >> 2) & 0x33333333u) | ((b & 0x33333333u) << 2);
+	b = ((b >> 4) & 0x0F0F0F0Fu) | ((b & 0x0F0F0F0Fu) << 4);
+	b = ((b >> 8) & 0x00FF00FFu) | ((b & 0x00FF00FFu) << 8);
+	return (b >> 16) | (b << 16);
+}
+
+// Square s becomes 31 - s when the board is rotated half a turn
+extern bitboard_t tb_normalize(const bitboard_t *bb, piece_color_t turn) {
+	if (turn == PIECE_BLACK)
+		return *bb;
+	bitboard_t result;
+	result.color[PIECE_BLACK] = reverse_bits(bb->color[PIECE_WHITE]);
+	result.color[PIECE_WHITE] = reverse_bits(bb->color[PIECE_BLACK]);
+	result.kings = reverse_bits(bb->kings);
+	return result;
+}
+
+extern tb_material_t tb_material(const bitboard_t *normalized) {
+	tb_material_t result;
+	for (int i = 0; i < 2; i++) {
+		uint32_t pieces = normalized->color[i ? PIECE_WHITE : PIECE_BLACK];
+		result.men[i] = (int8_t)bb_count(pieces & ~normalized->kings);
+		result.kings[i] = (int8_t)bb_count(pieces & normalized->kings);
+	}
+	return result;
+}
+
+extern uint64_t tb_size(tb_material_t m) {
+	return binomial(black_men.squares, m.men[0]) * binomial(kings.squares, m.kings[0])
+		* binomial(white_men.squares, m.men[1]) * binomial(kings.squares, m.kings[1]);
+}
+
+extern uint64_t tb_index(tb_material_t m, const bitboard_t *bb) {
+	uint32_t black = bb->color[PIECE_BLACK];
+	uint32_t white = bb->color[PIECE_WHITE];
+	uint64_t index = rank(black & ~bb->kings, black_men);
+	index = index * binomial(kings.squares, m.kings[0]) + rank(black & bb->kings, kings);
+	index = index * binomial(white_men.squares, m.men[1]) + rank(white & ~bb->kings, white_men);
+	index = index * binomial(kings.squares, m.kings[1]) + rank(white & bb->kings, kings);
+	return index;
+}
+
+// Returns false when the index puts two pieces on the same square
+extern bool tb_position(tb_material_t m, uint64_t index, bitboard_t *bb) {
+	uint64_t size;
+	size = binomial(kings.squares, m.kings[1]);
+	uint32_t white_kings = unrank(index % size, m.kings[1], kings);
+	index /= size;
+	size = binomial(white_men.squares, m.men[1]);
+	uint32_t white = unrank(index % size, m.men[1], white_men);
+	index /= size;
+	size = binomial(kings.squares, m.kings[0]);
+	uint32_t black_kings = unrank(index % size, m.kings[0], kings);
+	index /= size;
+	uint32_t black = unrank(index, m.men[0], black_men);
+
+	if ((white & white_kings) || (black & black_kings))
+		return false;
+	white |= white_kings;
+	black |= black_kings;
+	if (white & black)
+		return false;
+	bb->color[PIECE_BLACK] = black;
+	bb->color[PIECE_WHITE] = white;
+	bb->kings = white_kings | black_kings;
+	return true;
+}
+
+// Side to move first, e.g. "m2k0-m0k1.tb"
+extern void tb_file_name(tb_material_t m, const char *extension, char *name, size_t size) {
+	snprintf(name, size, "m%dk%d-m%dk%d.%s", m.men[0], m.kings[0], m.men[1], m.kings[1], extension);
+}
+
+/*
+ * WDL files: a 16 byte header, the offsets of the blocks from the start of
+ * the file (block count + 1 little endian uint32) and the blocks. A block
+ * starts with its encoding and holds two bits per position, in one of:
+ *
+ *   BLOCK_PACKED  four positions per byte, the first one in the low bits
+ *   BLOCK_RUNS    one byte per run of up to 64 equal results, the result in
+ *                 the high two bits and the length minus one in the others
+ *
+ * whichever is smaller. Invalid positions take the result before them, so
+ * they never break a run.
+ */
+
+#define WDL_MAGIC "NCWD"
+#define WDL_VERSION 1
+#define WDL_HEADER_SIZE 16
+#define CACHE_SLOTS 256 // decoded blocks, about 1KB each
+
+enum { WDL_DRAW, WDL_WIN, WDL_LOSS };
+enum { BLOCK_PACKED, BLOCK_RUNS };
+
+typedef struct {
+	file_map_t map; // map.data is 0 when there is no file
+	uint32_t blocks;
+} wdl_file_t;
+
+// The runs of a block decoded to the packed encoding
+typedef struct {
+	volatile int lock;
+	const wdl_file_t *file;
+	uint32_t block;
+	uint8_t packed[TB_BLOCK_SIZE / 4];
+} cache_slot_t;
+
+struct _tablebase {
+	wdl_file_t files[TB_MAX_PIECES + 1][TB_MAX_PIECES + 1][TB_MAX_PIECES + 1][TB_MAX_PIECES + 1];
+	int max_pieces;
+	cache_slot_t cache[CACHE_SLOTS];
+};
+
+static uint32_t read_u32(const uint8_t *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void write_u32(uint8_t *p, uint32_t value) {
+	for (int i = 0; i < 4; i++)
+		p[i] = (uint8_t)(value >> (8 * i));
+}
+
+static int wdl_of(uint8_t value) {
+	int result = tb_result(value);
+	return (result > 0) ? WDL_WIN : (result < 0) ? WDL_LOSS : WDL_DRAW;
+}
+
+// Returns the encoded size of the block in out
+static size_t encode_block(const uint8_t *values, size_t count, uint8_t *out) {
+	uint8_t wdl[TB_BLOCK_SIZE];
+	int last = WDL_DRAW;
+	for (size_t i = 0; i < count; i++) {
+		if (values[i] != TB_INVALID)
+			last = wdl_of(values[i]);
+		wdl[i] = (uint8_t)last;
+	}
+
+	size_t runs = 1;
+	for (size_t i = 0; i < count; ) {
+		size_t length = 1;
+		while (i + length < count && length < 64 && wdl[i + length] == wdl[i])
+			length++;
+		out[runs++] = (uint8_t)(wdl[i] << 6 | (length - 1));
+		i += length;
+	}
+	size_t packed = 1 + (count + 3) / 4;
+	if (runs <= packed) {
+		out[0] = BLOCK_RUNS;
+		return runs;
+	}
+
+	out[0] = BLOCK_PACKED;
+	memset(out + 1, 0, packed - 1);
+	for (size_t i = 0; i < count; i++)
+		out[1 + i / 4] |= wdl[i] << (2 * (i % 4));
+	return packed;
+}
+
+extern bool tb_write_wdl(const char *path, tb_material_t m, const uint8_t *values) {
+	uint64_t size = tb_size(m);
+	uint32_t blocks = (uint32_t)((size + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE);
+	size_t offsets_size = 4 * ((size_t)blocks + 1);
+	uint8_t *offsets = malloc(offsets_size);
+	if (!offsets) {
+		perror("ERROR malloc");
+		return false;
+	}
+	FILE *file = fopen(path, "wb");
+	if (!file) {
+		perror(path);
+		free(offsets);
+		return false;
+	}
+
+	uint8_t header[WDL_HEADER_SIZE] = WDL_MAGIC;
+	header[4] = WDL_VERSION;
+	header[5] = m.men[0];
+	header[6] = m.kings[0];
+	header[7] = m.men[1];
+	header[8] = m.kings[1];
+	write_u32(header + 12, blocks);
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+	// the offsets are only known once the blocks are written
+	ok = ok && fwrite(offsets, offsets_size, 1, file) == 1;
+	uint32_t offset = WDL_HEADER_SIZE + (uint32_t)offsets_size;
+	uint8_t block[1 + TB_BLOCK_SIZE];
+	for (uint32_t i = 0; ok && i < blocks; i++) {
+		uint64_t first = (uint64_t)i * TB_BLOCK_SIZE;
+		size_t count = (size - first < TB_BLOCK_SIZE) ? (size_t)(size - first) : TB_BLOCK_SIZE;
+		size_t length = encode_block(values + first, count, block);
+		write_u32(offsets + 4 * i, offset);
+		offset += (uint32_t)length;
+		ok = fwrite(block, length, 1, file) == 1;
+	}
+	write_u32(offsets + 4 * blocks, offset);
+	ok = ok && fseek(file, WDL_HEADER_SIZE, SEEK_SET) == 0
+		&& fwrite(offsets, offsets_size, 1, file) == 1;
+
+	if (fclose(file) != 0)
+		ok = false;
+	if (!ok)
+		perror(path);
+	free(offsets);
+	return ok;
+}
+
+// Rejects files that don't match their name or would be read out of bounds
+static bool check_file(const wdl_file_t *file, tb_material_t m) {
+	if (file->map.size < WDL_HEADER_SIZE || memcmp(file->map.data, WDL_MAGIC, 4) != 0 || file->map.data[4] != WDL_VERSION)
+		return false;
+	if (file->map.data[5] != m.men[0] || file->map.data[6] != m.kings[0] || file->map.data[7] != m.men[1] || file->map.data[8] != m.kings[1])
+		return false;
+	uint64_t blocks = read_u32(file->map.data + 12);
+	if (blocks != (tb_size(m) + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE || WDL_HEADER_SIZE + 4 * (blocks + 1) > file->map.size)
+		return false;
+	const uint8_t *offsets = file->map.data + WDL_HEADER_SIZE;
+	return read_u32(offsets + 4 * blocks) <= file->map.size;
+}
+
+extern tablebase_t *tb_open(const char *directory) {
+	tablebase_t *tb = calloc(1, sizeof(tablebase_t));
+	if (!tb) {
+		perror("ERROR calloc");
+		return 0;
+	}
+	if (!RULES_AMERICAN)
+		return tb;
+	for (int m0 = 0; m0 <= TB_MAX_PIECES; m0++)
+	for (int k0 = 0; m0 + k0 <= TB_MAX_PIECES; k0++)
+	for (int m1 = 0; m0 + k0 + m1 <= TB_MAX_PIECES; m1++)
+	for (int k1 = 0; m0 + k0 + m1 + k1 <= TB_MAX_PIECES; k1++) {
+		if (m0 + k0 == 0 || m1 + k1 == 0)
+			continue;
+		tb_material_t m = { { m0, m1 }, { k0, k1 } };
+		char name[64], path[1024];
+		tb_file_name(m, "wdl", name, sizeof(name));
+		snprintf(path, sizeof(path), "%s/%s", directory, name);
+		wdl_file_t *file = &tb->files[m0][k0][m1][k1];
+		if (!file_map_open(&file->map, path))
+			continue;
+		if (!check_file(file, m)) {
+			fprintf(stderr, "ERROR invalid tablebase file: %s\n", path);
+			file_map_close(&file->map);
+			continue;
+		}
+		file->blocks = read_u32(file->map.data + 12);
+		if (tb_pieces(m) > tb->max_pieces)
+			tb->max_pieces = tb_pieces(m);
+	}
+	return tb;
+}
+
+extern void tb_close(tablebase_t *tb) {
+	for (int m0 = 0; m0 <= TB_MAX_PIECES; m0++)
+	for (int k0 = 0; k0 <= TB_MAX_PIECES; k0++)
+	for (int m1 = 0; m1 <= TB_MAX_PIECES; m1++)
+	for (int k1 = 0; k1 <= TB_MAX_PIECES; k1++) {
+		if (tb->files[m0][k0][m1][k1].map.data)
+			file_map_close(&tb->files[m0][k0][m1][k1].map);
+	}
+	free(tb);
+}
+
+extern int tb_max_pieces(const tablebase_t *tb) {
+	return tb->max_pieces;
+}
+
+static int decode_runs(const uint8_t *runs, const uint8_t *end, uint32_t position) {
+	for (; runs < end; runs++) {
+		uint32_t length = (*runs & 63) + 1u;
+		if (position < length)
+			return *runs >> 6;
+		position -= length;
+	}
+	return WDL_DRAW;
+}
+
+static void unpack_runs(const uint8_t *runs, const uint8_t *end, uint8_t packed[TB_BLOCK_SIZE / 4]) {
+	memset(packed, 0, TB_BLOCK_SIZE / 4);
+	uint32_t position = 0;
+	for (; runs < end; runs++) {
+		uint32_t length = (*runs & 63) + 1u;
+		for (uint32_t i = 0; i < length && position < TB_BLOCK_SIZE; i++, position++)
+			packed[position / 4] |= (*runs >> 6) << (2 * (position % 4));
+	}
+}
+
+// Runs are decoded once into the cache, so the next probes of the same block
+// cost as much as a packed one. A slot that is busy isn't waited for, the
+// runs are just scanned.
+static int probe_runs(tablebase_t *tb, const wdl_file_t *file, uint32_t block, const uint8_t *runs, const uint8_t *end, uint32_t position) {
+	uintptr_t key = (uintptr_t)file / sizeof(wdl_file_t) * 31 + block;
+	cache_slot_t *slot = tb->cache + (key & (CACHE_SLOTS - 1));
+	if (!thread_spin_trylock(&slot->lock))
+		return decode_runs(runs, end, position);
+	if (slot->file != file || slot->block != block) {
+		unpack_runs(runs, end, slot->packed);
+		slot->file = file;
+		slot->block = block;
+	}
+	int result = (slot->packed[position / 4] >> (2 * (position % 4))) & 3;
+	thread_spin_unlock(&slot->lock);
+	return result;
+}
+
+extern bool tb_probe(tablebase_t *tb, const bitboard_t *bb, piece_color_t turn, tb_wdl_t *result) {
+	bitboard_t normalized = tb_normalize(bb, turn);
+	if (!normalized.color[PIECE_BLACK] || !normalized.color[PIECE_WHITE])
+		return false;
+	tb_material_t m = tb_material(&normalized);
+	if (tb_pieces(m) > tb->max_pieces)
+		return false;
+	const wdl_file_t *file = &tb->files[m.men[0]][m.kings[0]][m.men[1]][m.kings[1]];
+	if (!file->map.data)
+		return false;
+
+	uint64_t index = tb_index(m, &normalized);
+	uint32_t block = (uint32_t)(index / TB_BLOCK_SIZE);
+	uint32_t position = (uint32_t)(index % TB_BLOCK_SIZE);
+	const uint8_t *offsets = file->map.data + WDL_HEADER_SIZE + 4 * (size_t)block;
+	uint32_t begin = read_u32(offsets);
+	uint32_t end = read_u32(offsets + 4);
+	if (begin >= end || end > file->map.size)
+		return false;
+
+	const uint8_t *data = file->map.data + begin;
+	int wdl;
+	if (data[0] == BLOCK_PACKED) {
+		if (1 + position / 4 >= end - begin)
+			return false;
+		wdl = (data[1 + position / 4] >> (2 * (position % 4))) & 3;
+	} else {
+		wdl = probe_runs(tb, file, block, data + 1, file->map.data + end, position);
+	}
+	*result = (wdl == WDL_WIN) ? TB_RESULT_WIN : (wdl == WDL_LOSS) ? TB_RESULT_LOSS : TB_RESULT_DRAW;
+	return true;
+}
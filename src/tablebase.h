@@ -0,0 +1,73 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bitboard.h"
+
+#if RULES_BOARD_SIZE != 8
+	#error "tablebases index the 32 squares of the 8x8 board"
+#endif
+
+/*
+ * Endgame tablebases, one file per material signature. Positions are always
+ * stored with black to move: a position with white to move is rotated half a
+ * turn and has its colors swapped first (tb_normalize).
+ *
+ * The generator writes two files for each signature. The ".tb" file holds one
+ * byte per position: the distance in turns to the end of the game plus one.
+ * The side to move wins when the distance is odd and loses when it is even,
+ * so 1 is a position without moves. The ".wdl" file only holds the result,
+ * compressed in blocks of TB_BLOCK_SIZE positions, and is what the engine
+ * probes (through a read-only mapping shared by all processes).
+ */
+
+#define TB_MAX_PIECES 8
+#define TB_MAX_DISTANCE 253
+#define TB_BLOCK_SIZE 4096
+
+#define TB_DRAW 0
+#define TB_INVALID 255 // the index puts two pieces on the same square
+
+typedef struct {
+	int8_t men[2]; // [0] the side to move, [1] the opponent
+	int8_t kings[2];
+} tb_material_t;
+
+static inline uint8_t tb_value(int distance) {
+	return (uint8_t)(distance + 1);
+}
+
+static inline int tb_distance(uint8_t value) {
+	return value - 1;
+}
+
+// 1 when the side to move wins, -1 when it loses and 0 for draws
+static inline int tb_result(uint8_t value) {
+	if (value == TB_DRAW || value == TB_INVALID)
+		return 0;
+	return (tb_distance(value) & 1) ? 1 : -1;
+}
+
+static inline int tb_pieces(tb_material_t material) {
+	return material.men[0] + material.kings[0] + material.men[1] + material.kings[1];
+}
+
+bitboard_t tb_normalize(const bitboard_t *bb, piece_color_t turn);
+tb_material_t tb_material(const bitboard_t *normalized);
+uint64_t tb_size(tb_material_t material);
+uint64_t tb_index(tb_material_t material, const bitboard_t *normalized);
+bool tb_position(tb_material_t material, uint64_t index, bitboard_t *normalized);
+void tb_file_name(tb_material_t material, const char *extension, char *name, size_t size);
+
+bool tb_write_wdl(const char *path, tb_material_t material, const uint8_t *values);
+
+typedef enum { TB_RESULT_LOSS = -1, TB_RESULT_DRAW, TB_RESULT_WIN } tb_wdl_t;
+
+// The .wdl files of a directory, probed from any number of threads
+typedef struct _tablebase tablebase_t;
+
+// Finds no file with rules other than the U.S. ones, the only ones tbgen knows
+tablebase_t *tb_open(const char *directory);
+void tb_close(tablebase_t *tb);
+int tb_max_pieces(const tablebase_t *tb); // 0 when no file was found
+bool tb_probe(tablebase_t *tb, const bitboard_t *bb, piece_color_t turn, tb_wdl_t *result);
@@ -0,0 +1,345 @@
+/*
+ * Generates the endgame tablebases of every material signature with up to a
+ * given number of pieces, by retrograde analysis in passes: pass d finds every
+ * position that ends the game in exactly d turns.
+ *
+ * Captures and crownings only lead to signatures with fewer pieces or fewer
+ * men, so signatures are solved in classes of equal piece and man counts,
+ * smallest first, and moves leaving a class find their results in tables
+ * already complete. Each pass splits the index space of the class in chunks
+ * taken by all the threads.
+ *
+ * A position is only solved again in the pass after one of its successors got
+ * a result (found by undoing the quiet moves of the result), or in the pass
+ * the distances it already knows can decide it.
+ *
+ * Output is a distance file and a compressed result file per signature (see
+ * tablebase.h), plus one tab separated line on stdout.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "tablebase.h"
+#include "thread.h"
+#include "timer.h"
+
+#if !RULES_AMERICAN
+	#error "the moves are undone with the U.S. rules"
+#endif
+
+#define CHUNK_SIZE 4096
+#define MAX_THREADS 256
+#define FILE_MAGIC "NCTB"
+#define FILE_VERSION 1
+
+typedef struct {
+	tb_material_t material;
+	uint64_t size;
+	uint64_t first; // position of the table in the index space of its class
+	uint8_t *values;
+	uint8_t *dirty; // pass when a successor got a result, set by any thread
+	uint8_t *wake; // pass when known results decide it, set by the owner
+} table_t;
+
+typedef struct {
+	table_t *tables[(TB_MAX_PIECES / 2 + 1) * (TB_MAX_PIECES / 2 + 1)];
+	int count;
+	uint64_t size;
+	int distance; // the pass
+	volatile int next_chunk;
+	volatile int changed;
+} pass_t;
+
+// [men[0]][kings[0]][men[1]][kings[1]]
+static table_t *tables[TB_MAX_PIECES + 1][TB_MAX_PIECES + 1][TB_MAX_PIECES + 1][TB_MAX_PIECES + 1];
+
+static table_t *find_table(const bitboard_t *normalized, uint64_t *index) {
+	tb_material_t m = tb_material(normalized);
+	table_t *table = tables[m.men[0]][m.kings[0]][m.men[1]][m.kings[1]];
+	*index = tb_index(m, normalized);
+	return table;
+}
+
+static uint8_t lookup(const bitboard_t *bb, piece_color_t turn) {
+	bitboard_t normalized = tb_normalize(bb, turn);
+	if (!normalized.color[PIECE_BLACK])
+		return tb_value(0);
+	uint64_t index;
+	table_t *table = find_table(&normalized, &index);
+	return table->values[index];
+}
+
+// Returns the value of the position if the results from earlier passes decide
+// it. Otherwise returns TB_DRAW and sets wake to the first pass the results
+// known so far could decide it, or 0. Results found in this same pass are
+// ignored, so the outcome doesn't depend on the order the threads visit the
+// positions.
+static uint8_t solve(const bitboard_t *bb, int distance, uint8_t *wake) {
+	*wake = 0;
+	bb_move_t moves[BB_MAX_MOVES];
+	int count = bb_generate_moves(bb, PIECE_BLACK, moves);
+	if (count == 0)
+		return tb_value(0);
+
+	int shortest_loss = TB_MAX_DISTANCE + 1;
+	int longest_win = -1;
+	bool all_won = true;
+	for (int i = 0; i < count; i++) {
+		bitboard_t next = *bb;
+		bb_apply_move(&next, moves + i);
+		uint8_t value = lookup(&next, PIECE_WHITE);
+		int result = tb_result(value);
+		if (result < 0 && tb_distance(value) < shortest_loss)
+			shortest_loss = tb_distance(value);
+		else if (result > 0 && tb_distance(value) > longest_win)
+			longest_win = tb_distance(value);
+		if (result <= 0)
+			all_won = false;
+	}
+
+	if (shortest_loss < distance)
+		return tb_value(shortest_loss + 1);
+	if (all_won && longest_win < distance)
+		return tb_value(longest_win + 1);
+	if (shortest_loss <= TB_MAX_DISTANCE)
+		*wake = (uint8_t)(shortest_loss + 1);
+	else if (all_won)
+		*wake = (uint8_t)(longest_win + 1);
+	return TB_DRAW;
+}
+
+// Flags the positions of the class that reach bb by a quiet move of white
+static void mark_predecessors(const bitboard_t *bb, int distance) {
+	uint32_t empty = ~(bb->color[PIECE_BLACK] | bb->color[PIECE_WHITE]);
+	uint32_t white = bb->color[PIECE_WHITE];
+	for (uint32_t pieces = white; pieces; pieces &= pieces - 1) {
+		uint32_t bit = pieces & -pieces;
+		bool king = (bb->kings & bit) != 0;
+		for (int dir = 0; dir < 4; dir++) {
+			if (!king && !bb_forward(PIECE_WHITE, dir))
+				continue;
+			uint32_t from = bb_shift(bit, BB_OPPOSITE(dir)) & empty;
+			if (!from)
+				continue;
+			bitboard_t previous = *bb;
+			previous.color[PIECE_WHITE] ^= bit | from;
+			if (king)
+				previous.kings ^= bit | from;
+			// the move wasn't allowed if white had a capture
+			if (bb_jumpers(&previous, PIECE_WHITE))
+				continue;
+			bitboard_t normalized = tb_normalize(&previous, PIECE_WHITE);
+			uint64_t index;
+			table_t *table = find_table(&normalized, &index);
+			table->dirty[index] = (uint8_t)(distance + 1);
+		}
+	}
+}
+
+static int pass_thread_proc(void *data) {
+	pass_t *pass = data;
+	int changed = 0;
+	for (;;) {
+		uint64_t begin = (uint64_t)thread_atomic_add(&pass->next_chunk, 1) * CHUNK_SIZE;
+		if (begin >= pass->size)
+			break;
+		uint64_t end = begin + CHUNK_SIZE;
+		if (end > pass->size)
+			end = pass->size;
+
+		for (int t = 0; t < pass->count; t++) {
+			table_t *table = pass->tables[t];
+			if (end <= table->first || begin >= table->first + table->size)
+				continue;
+			uint64_t from = (begin > table->first) ? begin - table->first : 0;
+			uint64_t to = (end < table->first + table->size) ? end - table->first : table->size;
+			for (uint64_t index = from; index < to; index++) {
+				if (table->values[index] != TB_DRAW)
+					continue;
+				int distance = pass->distance;
+				// dirty can already be flagged for the next pass by a successor
+				// solved earlier in this one
+				if (distance > 0 && table->dirty[index] < distance && table->wake[index] != distance)
+					continue;
+				bitboard_t bb;
+				if (!tb_position(table->material, index, &bb)) {
+					table->values[index] = TB_INVALID;
+					continue;
+				}
+				uint8_t value = solve(&bb, distance, table->wake + index);
+				if (value != TB_DRAW) {
+					table->values[index] = value;
+					mark_predecessors(&bb, distance);
+					changed++;
+				}
+			}
+		}
+	}
+	thread_atomic_add(&pass->changed, changed);
+	return 0;
+}
+
+static int run_pass(pass_t *pass, int thread_count) {
+	thread_t *handles[MAX_THREADS] = {0};
+	pass->next_chunk = 0;
+	pass->changed = 0;
+	for (int i = 1; i < thread_count; i++)
+		handles[i] = thread_create(pass_thread_proc, pass);
+	pass_thread_proc(pass);
+	for (int i = 1; i < thread_count; i++) {
+		if (handles[i])
+			thread_join(handles[i]);
+	}
+	return pass->changed;
+}
+
+static bool write_table(const table_t *table, const char *directory) {
+	char name[64], path[1024];
+	tb_file_name(table->material, "tb", name, sizeof(name));
+	snprintf(path, sizeof(path), "%s/%s", directory, name);
+	FILE *file = fopen(path, "wb");
+	if (!file) {
+		perror(path);
+		return false;
+	}
+	uint8_t header[16] = FILE_MAGIC;
+	header[4] = FILE_VERSION;
+	header[5] = table->material.men[0];
+	header[6] = table->material.kings[0];
+	header[7] = table->material.men[1];
+	header[8] = table->material.kings[1];
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1
+		&& fwrite(table->values, 1, table->size, file) == table->size;
+	if (fclose(file) != 0)
+		ok = false;
+	if (!ok) {
+		perror(path);
+		return false;
+	}
+
+	tb_file_name(table->material, "wdl", name, sizeof(name));
+	snprintf(path, sizeof(path), "%s/%s", directory, name);
+	return tb_write_wdl(path, table->material, table->values);
+}
+
+static void print_table(const table_t *table, double seconds) {
+	uint64_t wins = 0, losses = 0, draws = 0;
+	int longest = 0;
+	for (uint64_t i = 0; i < table->size; i++) {
+		uint8_t value = table->values[i];
+		if (value == TB_INVALID)
+			continue;
+		int result = tb_result(value);
+		if (result > 0)
+			wins++;
+		else if (result < 0)
+			losses++;
+		else
+			draws++;
+		if (value != TB_DRAW && tb_distance(value) > longest)
+			longest = tb_distance(value);
+	}
+	char name[64];
+	tb_file_name(table->material, "tb", name, sizeof(name));
+	printf("%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%d\t%.3f\n",
+		name, wins + losses + draws, wins, losses, draws, longest, seconds);
+	fflush(stdout);
+}
+
+// Solves every signature with the given number of pieces and men
+static bool solve_class(int pieces, int men, int thread_count, int *longest) {
+	pass_t pass = {0};
+	for (int m0 = 0; m0 <= men; m0++) {
+		int m1 = men - m0;
+		for (int k0 = 0; k0 <= pieces - men; k0++) {
+			int k1 = pieces - men - k0;
+			if (m0 + k0 == 0 || m1 + k1 == 0)
+				continue;
+			tb_material_t material = { { m0, m1 }, { k0, k1 } };
+			table_t *table = malloc(sizeof(table_t));
+			if (!table) {
+				perror("ERROR malloc");
+				return false;
+			}
+			table->material = material;
+			table->size = tb_size(material);
+			table->first = pass.size;
+			table->values = calloc(table->size, 1);
+			table->dirty = calloc(table->size, 1);
+			table->wake = calloc(table->size, 1);
+			if (!table->values || !table->dirty || !table->wake) {
+				perror("ERROR calloc");
+				return false;
+			}
+			tables[m0][k0][m1][k1] = table;
+			pass.tables[pass.count++] = table;
+			pass.size += table->size;
+		}
+	}
+	if (!pass.count)
+		return true;
+
+	// the longest result of the tables looked up bounds when a pass without
+	// changes means there's nothing left to find
+	for (pass.distance = 0; pass.distance <= TB_MAX_DISTANCE; pass.distance++) {
+		int changed = run_pass(&pass, thread_count);
+		if (changed && pass.distance > *longest)
+			*longest = pass.distance;
+		else if (pass.distance > *longest + 1)
+			break;
+	}
+	if (pass.distance > TB_MAX_DISTANCE) {
+		fprintf(stderr, "ERROR distance over %d turns\n", TB_MAX_DISTANCE);
+		return false;
+	}
+
+	for (int i = 0; i < pass.count; i++) {
+		free(pass.tables[i]->dirty);
+		free(pass.tables[i]->wake);
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3 || argc > 4 || atoi(argv[1]) < 2 || atoi(argv[1]) > TB_MAX_PIECES) {
+		fprintf(stderr,
+			"Usage:\n"
+			"    %s MAX_PIECES DIRECTORY [THREADS]\n"
+			"\n"
+			"MAX_PIECES goes from 2 to %d, THREADS defaults to the number of cores.\n",
+			argv[0], TB_MAX_PIECES
+		);
+		return 1;
+	}
+	int max_pieces = atoi(argv[1]);
+	const char *directory = argv[2];
+	int thread_count = (argc > 3) ? atoi(argv[3]) : thread_cpu_count();
+	if (thread_count < 1)
+		thread_count = 1;
+	else if (thread_count > MAX_THREADS)
+		thread_count = MAX_THREADS;
+
+	printf("table\tpositions\twins\tlosses\tdraws\tlongest\tseconds\n");
+	int longest = 0;
+	for (int pieces = 2; pieces <= max_pieces; pieces++) {
+		for (int men = 0; men <= pieces; men++) {
+			double start = timer_seconds();
+			if (!solve_class(pieces, men, thread_count, &longest))
+				return 1;
+			double seconds = timer_seconds() - start;
+			for (int m0 = 0; m0 <= men; m0++) {
+				for (int k0 = 0; k0 <= pieces - men; k0++) {
+					table_t *table = tables[m0][k0][men - m0][pieces - men - k0];
+					if (!table)
+						continue;
+					if (!write_table(table, directory))
+						return 1;
+					print_table(table, seconds);
+				}
+			}
+		}
+	}
+	return 0;
+}
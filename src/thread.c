@@ -0,0 +1,108 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200112L // sysconf
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "thread.h"
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+struct _thread {
+	HANDLE handle;
+	thread_proc_t proc;
+	void *data;
+	int result;
+};
+
+static DWORD WINAPI thread_start(LPVOID param) {
+	thread_t *thread = param;
+	thread->result = thread->proc(thread->data);
+	return 0;
+}
+
+extern thread_t *thread_create(thread_proc_t proc, void *data) {
+	thread_t *thread = malloc(sizeof(thread_t));
+	if (!thread) {
+		perror("ERROR malloc");
+		return 0;
+	}
+	thread->proc = proc;
+	thread->data = data;
+	thread->result = 0;
+	thread->handle = CreateThread(0, 0, thread_start, thread, 0, 0);
+	if (!thread->handle) {
+		fprintf(stderr, "ERROR CreateThread: %lu\n", GetLastError());
+		free(thread);
+		return 0;
+	}
+	return thread;
+}
+
+extern int thread_join(thread_t *thread) {
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	int result = thread->result;
+	free(thread);
+	return result;
+}
+
+extern int thread_cpu_count() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
+
+#else
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+struct _thread {
+	pthread_t handle;
+	thread_proc_t proc;
+	void *data;
+	int result;
+};
+
+static void *thread_start(void *param) {
+	thread_t *thread = param;
+	thread->result = thread->proc(thread->data);
+	return 0;
+}
+
+extern thread_t *thread_create(thread_proc_t proc, void *data) {
+	thread_t *thread = malloc(sizeof(thread_t));
+	if (!thread) {
+		perror("ERROR malloc");
+		return 0;
+	}
+	thread->proc = proc;
+	thread->data = data;
+	thread->result = 0;
+	int err = pthread_create(&thread->handle, 0, thread_start, thread);
+	if (err) {
+		fprintf(stderr, "ERROR pthread_create: %s\n", strerror(err));
+		free(thread);
+		return 0;
+	}
+	return thread;
+}
+
+extern int thread_join(thread_t *thread) {
+	pthread_join(thread->handle, 0);
+	int result = thread->result;
+	free(thread);
+	return result;
+}
+
+extern int thread_cpu_count() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (int)count : 1;
+}
+
+#endif
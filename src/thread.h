@@ -0,0 +1,82 @@
+#pragma once
+#include <stdbool.h>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+/*
+ * Threads and atomics for the code that doesn't link SDL (search and tools).
+ */
+
+typedef struct _thread thread_t;
+typedef int (*thread_proc_t)(void *data);
+
+thread_t *thread_create(thread_proc_t proc, void *data);
+int thread_join(thread_t *thread);
+int thread_cpu_count();
+
+#ifdef _MSC_VER
+
+static inline int thread_atomic_get(volatile int *value) {
+	return _InterlockedOr((volatile long *)value, 0);
+}
+
+static inline void thread_atomic_set(volatile int *value, int v) {
+	_InterlockedExchange((volatile long *)value, v);
+}
+
+// Returns the value from before the addition
+static inline int thread_atomic_add(volatile int *value, int v) {
+	return _InterlockedExchangeAdd((volatile long *)value, v);
+}
+
+// Sets value to desired only if it still holds expected, true if it did
+static inline bool thread_atomic_compare_exchange(volatile int *value, int expected, int desired) {
+	return _InterlockedCompareExchange((volatile long *)value, desired, expected) == expected;
+}
+
+static inline bool thread_spin_trylock(volatile int *lock) {
+	return _InterlockedExchange((volatile long *)lock, 1) == 0;
+}
+
+static inline void thread_spin_unlock(volatile int *lock) {
+	_InterlockedExchange((volatile long *)lock, 0);
+}
+
+#else
+
+static inline int thread_atomic_get(volatile int *value) {
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline void thread_atomic_set(volatile int *value, int v) {
+	__atomic_store_n(value, v, __ATOMIC_RELEASE);
+}
+
+// Returns the value from before the addition
+static inline int thread_atomic_add(volatile int *value, int v) {
+	return __atomic_fetch_add(value, v, __ATOMIC_ACQ_REL);
+}
+
+// Sets value to desired only if it still holds expected, true if it did
+static inline bool thread_atomic_compare_exchange(volatile int *value, int expected, int desired) {
+	return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline bool thread_spin_trylock(volatile int *lock) {
+	return __atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static inline void thread_spin_unlock(volatile int *lock) {
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+#endif
+
+static inline void thread_spin_lock(volatile int *lock) {
+	while (!thread_spin_trylock(lock)) {
+		while (thread_atomic_get(lock))
+			;
+	}
+}
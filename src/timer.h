@@ -0,0 +1,4 @@
+#pragma once
+
+// Monotonic wall clock in seconds, only meaningful as a difference
+double timer_seconds();
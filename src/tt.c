@@ -0,0 +1,182 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+	#define _DEFAULT_SOURCE // MAP_ANONYMOUS, madvise
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tt.h"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+#define BUCKET_ENTRIES 4
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Both words are read and written separately, check = key ^ data
+typedef struct {
+	volatile uint64_t check;
+	volatile uint64_t data;
+} tt_entry_t;
+
+// One bucket per cache line
+typedef struct {
+	tt_entry_t entries[BUCKET_ENTRIES];
+} tt_bucket_t;
+
+struct _tt {
+	tt_bucket_t *buckets;
+	size_t mask;
+	size_t size; // bytes
+	bool huge_pages; // allocated with explicit huge pages (must be freed as such)
+};
+
+static uint64_t pack_data(tt_data_t data) {
+	return (uint64_t)(uint16_t)data.score
+		| (uint64_t)(uint8_t)data.depth << 16
+		| (uint64_t)data.bound << 24
+		| (uint64_t)data.move << 32
+		| (uint64_t)1 << 40; // so a valid entry is never all zeros
+}
+
+static tt_data_t unpack_data(uint64_t packed) {
+	tt_data_t data;
+	data.score = (int16_t)(packed & 0xffff);
+	data.depth = (int8_t)((packed >> 16) & 0xff);
+	data.bound = (uint8_t)((packed >> 24) & 0xff);
+	data.move = (uint8_t)((packed >> 32) & 0xff);
+	return data;
+}
+
+// Tries explicit 2MB pages first, then transparent huge pages, then anything
+static void *alloc_table(size_t size, bool *huge_pages) {
+	*huge_pages = false;
+#ifdef _WIN32
+	SIZE_T large_page = GetLargePageMinimum();
+	if (large_page && size % large_page == 0) {
+		void *mem = VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (mem) {
+			*huge_pages = true;
+			return mem;
+		}
+	}
+	return VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	void *mem;
+	#ifdef MAP_HUGETLB
+	mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (mem != MAP_FAILED) {
+		*huge_pages = true;
+		return mem;
+	}
+	#endif
+	mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED)
+		return 0;
+	#ifdef MADV_HUGEPAGE
+	madvise(mem, size, MADV_HUGEPAGE);
+	#endif
+	return mem;
+#endif
+}
+
+static void free_table(void *mem, size_t size) {
+#ifdef _WIN32
+	(void)size;
+	VirtualFree(mem, 0, MEM_RELEASE);
+#else
+	munmap(mem, size);
+#endif
+}
+
+// The number of buckets is rounded down to a power of two
+extern tt_t *tt_create(size_t megabytes) {
+	size_t bytes = (megabytes ? megabytes : 1) * 1024 * 1024;
+	size_t count = 1;
+	while (count * 2 * sizeof(tt_bucket_t) <= bytes)
+		count *= 2;
+
+	tt_t *tt = malloc(sizeof(tt_t));
+	if (!tt) {
+		perror("ERROR malloc");
+		return 0;
+	}
+	memset(tt, 0, sizeof(tt_t));
+	tt->size = count * sizeof(tt_bucket_t);
+	if (tt->size % HUGE_PAGE_SIZE)
+		tt->size += HUGE_PAGE_SIZE - tt->size % HUGE_PAGE_SIZE;
+	tt->buckets = alloc_table(tt->size, &tt->huge_pages);
+	if (!tt->buckets) {
+		perror("ERROR mmap");
+		free(tt);
+		return 0;
+	}
+	tt->mask = count - 1;
+	return tt;
+}
+
+extern void tt_destroy(tt_t *tt) {
+	free_table(tt->buckets, tt->size);
+	free(tt);
+}
+
+extern void tt_clear(tt_t *tt) {
+	memset(tt->buckets, 0, (tt->mask + 1) * sizeof(tt_bucket_t));
+}
+
+extern void tt_prefetch(tt_t *tt, uint64_t key) {
+	const tt_bucket_t *bucket = tt->buckets + (key & tt->mask);
+#ifdef _MSC_VER
+	_mm_prefetch((const char *)bucket, _MM_HINT_T0);
+#else
+	__builtin_prefetch(bucket);
+#endif
+}
+
+extern bool tt_probe(tt_t *tt, uint64_t key, tt_data_t *data) {
+	tt_bucket_t *bucket = tt->buckets + (key & tt->mask);
+	for (int i = 0; i < BUCKET_ENTRIES; i++) {
+		uint64_t packed = bucket->entries[i].data;
+		uint64_t check = bucket->entries[i].check;
+		if (packed && (check ^ packed) == key) {
+			*data = unpack_data(packed);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Replaces the entry of the same position unless it is deeper, otherwise the
+// shallowest entry of the bucket
+extern void tt_store(tt_t *tt, uint64_t key, tt_data_t data) {
+	tt_bucket_t *bucket = tt->buckets + (key & tt->mask);
+	tt_entry_t *replace = bucket->entries;
+	int replace_depth = 256;
+	for (int i = 0; i < BUCKET_ENTRIES; i++) {
+		tt_entry_t *entry = bucket->entries + i;
+		uint64_t packed = entry->data;
+		if (packed && (entry->check ^ packed) == key) {
+			if (unpack_data(packed).depth > data.depth)
+				return;
+			replace = entry;
+			break;
+		}
+		int depth = packed ? unpack_data(packed).depth : -1;
+		if (depth < replace_depth) {
+			replace = entry;
+			replace_depth = depth;
+		}
+	}
+
+	uint64_t packed = pack_data(data);
+	replace->check = key ^ packed;
+	replace->data = packed;
+}
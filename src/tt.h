@@ -0,0 +1,31 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { TT_EXACT, TT_LOWER, TT_UPPER } tt_bound_t;
+
+#define TT_NO_MOVE 0xff
+
+typedef struct {
+	int16_t score;
+	int8_t depth;
+	uint8_t bound; // tt_bound_t
+	uint8_t move; // index in the generated move list, TT_NO_MOVE if unknown
+} tt_data_t;
+
+/*
+ * Transposition table shared by all search threads without locks. Each entry
+ * stores its key XORed with its data, so an entry torn by two concurrent
+ * writers doesn't verify and is just a miss.
+ */
+typedef struct _tt tt_t;
+
+tt_t *tt_create(size_t megabytes);
+void tt_destroy(tt_t *tt);
+void tt_clear(tt_t *tt);
+
+// Starts loading the bucket of key into the cache ahead of a probe
+void tt_prefetch(tt_t *tt, uint64_t key);
+bool tt_probe(tt_t *tt, uint64_t key, tt_data_t *data);
+void tt_store(tt_t *tt, uint64_t key, tt_data_t data);
@@ -0,0 +1,110 @@
+#include "zobrist.h"
+
+// Generated once with splitmix64. Keep the values fixed, hashes computed with
+// them are meant to be stored.
+const uint64_t zobrist_pieces[2][2][BB_SQUARES] = {
+	{
+		{ // black men
+			0xbced3b0a5921f7d6ull, 0x5b4fa932c7a24359ull, 0x6d48675329912246ull, 0xa172cc0daec1feedull,
+			0xc91bac4684178e24ull, 0xb7ab1e5242859f1eull, 0x4b3bea7aa7c45bd0ull, 0x7cfd378fe68ed6bcull,
+			0x25dc39062f31ee05ull, 0x379f5a59e87dd729ull, 0x38a88ccef3d9f9f1ull, 0xc838a9be96abdd4eull,
+			0xb5bf47098abf132eull, 0xe19c8ac439fd2797ull, 0x3c09da59d0b5ad38ull, 0xbe3e98c2e6b3da47ull,
+			0x4c7010c4f3e40dd8ull, 0xac1fb38d8ee54642ull, 0x28c9c6c2b9a01fdaull, 0x8412a8e72cf65c5full,
+			0xf1a01fe33bd9ac7cull, 0x2bac96f3eccac754ull, 0x92b2af6b88fabcb4ull, 0x804abfce692da8bcull,
+			0xa72a00f0ea8dcb1dull, 0x218d15b91cc020ffull, 0xe39f06fa0bbb3601ull, 0xa5bb4680be850ccfull,
+			0x8b35eb3cef26da8dull, 0x1b08f9bbdbebf6f1ull, 0x3a1e022905983130ull, 0xd7f6a664278e6876ull,
+#if RULES_BOARD_SIZE == 10
+			0x893c989febc2547cull, 0x73698ca3b9657f65ull, 0x69796dff7c705ee4ull, 0xdd048d12f1840dd6ull,
+			0xbf0bac9b43b5ea74ull, 0x6b471fd4cd702c7bull, 0x4ea1faf6a43dc8a8ull, 0xb0ba94e5038421afull,
+			0x073bb06d1ff97792ull, 0xe325feb7aa5de583ull, 0x7985808c82e001a9ull, 0xc82cfc55589cabd5ull,
+			0x260b45607fec436dull, 0x9f2d2739aa13e6e8ull, 0x90d70980b9e8faa0ull, 0xca94d9bb4e30ca04ull,
+			0xd4b5d78ecaac30dbull, 0x2df48a8342d40b52ull,
+#endif
+		},
+		{ // black kings
+			0xdd2d77b857ca9ad1ull, 0x468a2d8a2a6d96ddull, 0x815adeac63d59eb0ull, 0xff13c5d5104709dbull,
+			0x0bf10f14c6eed402ull, 0xeada5cd885192046ull, 0x58203bdb4af7ed1dull, 0xfd4dadd4efbfab8dull,
+			0xcba5d08188907c85ull, 0x3ef33317965db210ull, 0xad8610bcd20fadd1ull, 0x02f299ee26d989bcull,
+			0xa3f08657d3a3c991ull, 0xfba796d6c8151471ull, 0x58bca1519e1ec888ull, 0x87a0e8c8aae72241ull,
+			0xeb15ce7ff457d072ull, 0x76143798b3701b08ull, 0xa198a507410aa546ull, 0x4a6ab6197567ace3ull,
+			0x90e6d0a01c92a860ull, 0xf9c99c3ccd8a8c2full, 0x02ed0d6f72cc4fe2ull, 0xbedfb0a622bec206ull,
+			0xb9f89d412c437757ull, 0xe2665cc50b56a58eull, 0xff8ebd7315de1460ull, 0xa43b3ca57a6eeb3cull,
+			0x52a0e9f52657321full, 0x869f333a70ea82f7ull, 0xbbc5244a7b2347c4ull, 0x63875c91cb0f16dcull,
+#if RULES_BOARD_SIZE == 10
+			0x5e0de3c63cdfa454ull, 0x3917630055e65871ull, 0x498a21d4b2cbf237ull, 0xb92eeeb573247042ull,
+			0xfac281a95475fbd4ull, 0xe08f091207b865f0ull, 0x7d4324dafbe4f846ull, 0x500a9efeef72dfd8ull,
+			0xd3e3f6ca3fd2fbe5ull, 0x135f192acda515c8ull, 0xac59f97189b0877dull, 0xef181484ad49f053ull,
+			0xdebfd4d447f9219eull, 0xffa635605590de00ull, 0xe9d6a6666fd3ae9eull, 0x872ad5703da1dd98ull,
+			0x60799a775fc40392ull, 0x87ee00d655764da9ull,
+#endif
+		},
+	},
+	{
+		{ // white men
+			0xaa2b55677f5eaeb7ull, 0x81138b4c05293599ull, 0x9f2337863d69c556ull, 0xd983a3701638abceull,
+			0x4a2fb7f3da295af8ull, 0x912727f96d4fea93ull, 0x21022754f6a95a72ull, 0x77dabe0fb6824d55ull,
+			0xa75af5faab1e3c05ull, 0x84612dfffeb95ffcull, 0x1f73cbd941d117c0ull, 0x981b1a721577029aull,
+			0x45fd494fd1f4711bull, 0x6a2add954dcedc52ull, 0x8d300606d90b3834ull, 0x0ca3e4f0da546300ull,
+			0xcd097ee0dbe42f72ull, 0x9a2facd0808827f8ull, 0x909c60b9807eabd9ull, 0xf1e7a529b23d8fc3ull,
+			0xf6bfcb8425e62189ull, 0xf1f277b871838ddcull, 0xa053c03146da0611ull, 0xa7ca63561c237993ull,
+			0x6246b221cc4f5a1aull, 0x3ff845ef00a27321ull, 0x471ff08d42b2d137ull, 0xec3a2f6a52a67964ull,
+			0x69a644fc09734bc1ull, 0x7e4fd1d261b7149dull, 0xd9c949e186beebb5ull, 0x24740ea4df57efacull,
+#if RULES_BOARD_SIZE == 10
+			0x49ec3fda2b60fd6dull, 0x94147180e8c36b96ull, 0x44b3ef4e18642100ull, 0x9940449d8ffc7770ull,
+			0x94edadd3dd51baf1ull, 0xa2a408b84405339dull, 0xad4aba78daade898ull, 0xaf50ac3e6ca34d3eull,
+			0x8cd5cdbffd4659ccull, 0x68414a81fe01c610ull, 0x505300a5868bd14dull, 0xa21575c87a5a6038ull,
+			0xf1ca4281f8ef6776ull, 0x12d86a5a9c4afdccull, 0x19b9b679b1150385ull, 0x41f602c5465156bdull,
+			0x5c22f46952dc8b83ull, 0x8adff6a2032f07a2ull,
+#endif
+		},
+		{ // white kings
+			0x3715e7532412b3e9ull, 0x8dba6c64dce7c83dull, 0x9d87c0c6070aca6eull, 0x4660370badff842bull,
+			0xcd48c8e7e13e2ff7ull, 0xb24c232c5263ffaaull, 0x2dd0eaead6a3a6a1ull, 0xe5648b022fd459a4ull,
+			0x841ca7e122ba9116ull, 0x61ade22eff11ea2full, 0x484e63064aa2f138ull, 0x862b88bfbf0a6399ull,
+			0x821fac08a0556c3dull, 0x799ec158422bf058ull, 0x218954aad1ba4b37ull, 0x152e30480fc1fcecull,
+			0x153add33f2231dffull, 0x9145bc76bd1097ecull, 0xc70a523433d09beeull, 0x29209e77f14292e8ull,
+			0x4609c53b1d888cc3ull, 0xe1afe9a5c21b3ba9ull, 0xcbdf1b329c7daea3ull, 0x0caf073d3009a4f9ull,
+			0x10a7bc11ee2f5ad8ull, 0x001d87e99118f061ull, 0x1ec25cdaf607e9f4ull, 0x47e468c0bb8549e0ull,
+			0x4690a5dc76057861ull, 0x2b3194a58be95bc9ull, 0x30c9ebcfccce78c1ull, 0xdda10d4b571a1226ull,
+#if RULES_BOARD_SIZE == 10
+			0x6ad63aa54c78a6f2ull, 0x2dea95557b87b9e9ull, 0x11a9a7d470fb2a3eull, 0x12b6b9a50e6ab1b6ull,
+			0x71d7dbf52573dd38ull, 0x4aa31abfe02918b0ull, 0xb9b33e3bbcf74590ull, 0x3f8ec4448ac9e05cull,
+			0x29e3f88fcf4e3f1full, 0x9ef681ddb24e42c2ull, 0x7f58a1d32a9326aeull, 0xac9b9815804c11bfull,
+			0x76e0253c5d0091afull, 0x8106770d2a9f15bbull, 0x321d482d5906622full, 0x7db4fce6335ec99aull,
+			0x94c8f266eb665076ull, 0x2d860485e312f0f4ull,
+#endif
+		},
+	},
+};
+
+const uint64_t zobrist_white_turn = 0x58726f6e1b115834ull;
+
+extern uint64_t zobrist_hash(const bitboard_t *bb, piece_color_t turn) {
+	uint64_t result = (turn == PIECE_WHITE) ? zobrist_white_turn : 0;
+	for (int color = 0; color < 2; color++) {
+		for (bb_bits_t rest = bb->color[color]; rest; rest &= rest - 1) {
+			int square = bb_first(rest);
+			result ^= zobrist_pieces[color][(bb->kings >> square) & 1][square];
+		}
+	}
+	return result;
+}
+
+// Returns the value to xor into the hash of `bb` to get the hash after the
+// move, the change of turn included
+extern uint64_t zobrist_move(const bitboard_t *bb, const bb_move_t *move) {
+	int from = move->path[0];
+	int to = move->path[move->length];
+	piece_color_t color = ((bb->color[PIECE_WHITE] >> from) & 1) ? PIECE_WHITE : PIECE_BLACK;
+	int king = (bb->kings >> from) & 1;
+
+	uint64_t result = zobrist_white_turn;
+	result ^= zobrist_pieces[color][king][from];
+	result ^= zobrist_pieces[color][king | move->crown][to];
+	piece_color_t opponent = bb_other(color);
+	for (bb_bits_t rest = move->captures; rest; rest &= rest - 1) {
+		int square = bb_first(rest);
+		result ^= zobrist_pieces[opponent][(bb->kings >> square) & 1][square];
+	}
+	return result;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+#include "bitboard.h"
+
+// Random keys xor-ed together to hash a position: one per piece kind on each
+// square plus one for white to move
+extern const uint64_t zobrist_pieces[2][2][BB_SQUARES]; // [color][king][square]
+extern const uint64_t zobrist_white_turn;
+
+uint64_t zobrist_hash(const bitboard_t *bb, piece_color_t turn);
+uint64_t zobrist_move(const bitboard_t *bb, const bb_move_t *move);